@@ -0,0 +1,740 @@
+/*
+ * Generator of shift/xor sequences for crc_clsim.h.
+ *
+ * Searches for cheap shift/xor decompositions of carry-less multiplication
+ * by a constant (the MCM problem, but without carries), using randomized
+ * greedy common subexpression elimination, and prints a drop-in
+ * crcNN_clsim function for the given polynomial, or FOLD-style macros
+ * for a single constant.
+ *
+ * cc -O2 clsim_gen.c -o clsim_gen
+ * ./clsim_gen -p 0x82f63b78 -f crc32c_clsim
+ * ./clsim_gen -p 0x9a6c9329ac4bc9b5 -f crc64nvme_clsim
+ * ./clsim_gen -w 64 -k 0xdabe95afc7875f40
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t calc_lo(uint64_t p, uint64_t a, int n) {
+	uint64_t b = 0; int i;
+	for (i = 0; i < n; i++) {
+		b = b >> 1 | (a & 1) << (n - 1);
+		a = (a >> 1) ^ ((0 - (a & 1)) & p);
+	}
+	return b;
+}
+
+static uint64_t calc_hi(uint64_t p, uint64_t a, int n) {
+	int i;
+	for (i = 0; i < n; i++)
+		a = (a >> 1) ^ ((0 - (a & 1)) & p);
+	return a;
+}
+
+/* cost model */
+static int cost_shift = 1, cost_xor = 1, host_bits = 64;
+static double ipc = 4;
+static int iterations = 1000;
+
+#define MAX_ID 128
+#ifndef SLACK
+#define SLACK 2
+#endif
+
+typedef struct { int a, b, d; } def_t; /* id = a ^ b << d (or >> d) */
+typedef struct { int id, s; } term_t;
+
+typedef struct {
+	int dir;   /* 0: left shifts (low half), 1: right shifts (high half) */
+	int bits;  /* register width */
+	int ndef, nterm;
+	def_t def[MAX_ID];
+	term_t term[64];
+} prog_t;
+
+/* shifted values used more than once are computed once */
+static int prog_shared(const prog_t *p, int (*sh)[2]) {
+	int i, j, n = 0, id, s;
+	for (i = 0; i < p->ndef + p->nterm; i++) {
+		if (i < p->ndef) id = p->def[i].b, s = p->def[i].d;
+		else id = p->term[i - p->ndef].id, s = p->term[i - p->ndef].s;
+		if (!s) continue;
+		for (j = 0; j < n; j++)
+			if (sh[j][0] == id && sh[j][1] == s) break;
+		if (j == n) sh[n][0] = id, sh[n++][1] = s;
+	}
+	return n;
+}
+
+static int prog_shifts(const prog_t *p) {
+	int sh[MAX_ID + 64][2];
+	return prog_shared(p, sh);
+}
+
+/* number of temporaries: definitions and reused shifted values */
+static int prog_temps(const prog_t *p) {
+	int sh[MAX_ID + 64][2], i, j, n, id, s, cnt, r = p->ndef;
+	n = prog_shared(p, sh);
+	for (j = 0; j < n; j++) {
+		for (cnt = i = 0; i < p->ndef + p->nterm; i++) {
+			if (i < p->ndef) id = p->def[i].b, s = p->def[i].d;
+			else id = p->term[i - p->ndef].id, s = p->term[i - p->ndef].s;
+			cnt += sh[j][0] == id && sh[j][1] == s;
+		}
+		r += cnt > 1;
+	}
+	return r;
+}
+
+static int prog_xors(const prog_t *p) {
+	return p->ndef + (p->nterm > 1 ? p->nterm - 1 : 0);
+}
+
+static int prog_cost(const prog_t *p) {
+	int s = cost_shift, x = cost_xor;
+	/* a double-width value takes a pair of host registers */
+	if (p->bits > host_bits) s *= 3, x *= 2;
+	return prog_shifts(p) * s + prog_xors(p) * x;
+}
+
+static uint64_t prog_eval(const prog_t *p, uint64_t x) {
+	uint64_t val[MAX_ID + 1], r = 0, m = ~(uint64_t)0 >> (64 - p->bits);
+	int i;
+#define SHIFT(v, n) (p->dir ? (v) >> (n) : (v) << (n) & m)
+	val[0] = x & m;
+	for (i = 0; i < p->ndef; i++) {
+		const def_t *d = &p->def[i];
+		val[i + 1] = val[d->a] ^ SHIFT(val[d->b], d->d);
+	}
+	for (i = 0; i < p->nterm; i++)
+		r ^= SHIFT(val[p->term[i].id], p->term[i].s);
+#undef SHIFT
+	return r;
+}
+
+static uint64_t rng_state = 0x0123456789abcdef;
+
+static uint64_t rng(void) {
+	uint64_t x = rng_state;
+	x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+	return rng_state = x;
+}
+
+/*
+ * Randomized Hartley-style elimination: repeatedly find the most
+ * frequent pair pattern (a at s, b at s + d) among the terms,
+ * define it as a new subexpression and substitute it.
+ */
+static void search_once(prog_t *p, int random) {
+	static int cnt[MAX_ID][MAX_ID][64];
+	int keys[64 * 64][3], nkey, i, j, k, nban = 0;
+	int ban[64][3];
+
+	while (p->ndef < MAX_ID - 1) {
+		int best = 0, nbest = 0, pick, a, b, d, n, slack, dc;
+		int pos[MAX_ID][64];
+
+		nkey = 0;
+		for (i = 0; i < p->nterm; i++)
+		for (j = 0; j < p->nterm; j++) {
+			term_t *t0 = &p->term[i], *t1 = &p->term[j];
+			if (i == j || t0->s > t1->s) continue;
+			if (t0->s == t1->s && t0->id >= t1->id) continue;
+			a = t0->id; b = t1->id; d = t1->s - t0->s;
+			if (!cnt[a][b][d]++) {
+				keys[nkey][0] = a; keys[nkey][1] = b; keys[nkey][2] = d;
+				nkey++;
+			}
+		}
+		for (k = 0; k < nban; k++)
+			cnt[ban[k][0]][ban[k][1]][ban[k][2]] = 0;
+		/*
+		 * Bits shifted out of the register are don't-cares, so a lone
+		 * "a" term can take the pattern if "b" is shifted out entirely.
+		 */
+		dc = random && rng() & 1;
+		if (dc)
+			for (k = 0; k < nkey; k++)
+				if (cnt[keys[k][0]][keys[k][1]][keys[k][2]])
+				for (i = 0; i < p->nterm; i++)
+					if (p->term[i].id == keys[k][0] && p->term[i].s + keys[k][2] >= p->bits)
+						cnt[keys[k][0]][keys[k][1]][keys[k][2]]++;
+#define KEY_CNT(k) cnt[keys[k][0]][keys[k][1]][keys[k][2]]
+		for (k = 0; k < nkey; k++)
+			if (best < KEY_CNT(k)) best = KEY_CNT(k);
+		/* candidates close to the best when randomizing */
+		slack = random ? rng() % (SLACK + 1) : 0;
+#define KEY_OK(k) (KEY_CNT(k) >= 2 && KEY_CNT(k) >= best - slack)
+		for (k = 0; k < nkey; k++) nbest += KEY_OK(k);
+		pick = random && nbest ? rng() % nbest : 0;
+		for (k = 0; k < nkey; k++)
+			if (KEY_OK(k) && !pick--) break;
+#undef KEY_OK
+#undef KEY_CNT
+		a = k < nkey ? keys[k][0] : -1;
+		b = k < nkey ? keys[k][1] : -1;
+		d = k < nkey ? keys[k][2] : -1;
+		for (k = 0; k < nkey; k++)
+			cnt[keys[k][0]][keys[k][1]][keys[k][2]] = 0;
+		if (best < 2) break;
+
+		/* count non-overlapping occurrences */
+		memset(pos, -1, sizeof(pos));
+		for (i = 0; i < p->nterm; i++)
+			pos[p->term[i].id][p->term[i].s] = i;
+		n = 0;
+		for (i = 0; i < p->nterm; i++) {
+			int s = p->term[i].s;
+			if (p->term[i].id != a || pos[a][s] != i || s + d >= p->bits) continue;
+			j = pos[b][s + d];
+			if (j < 0 || j >= MAX_ID || j == i) continue;
+			pos[a][s] = pos[b][s + d] = MAX_ID + j;
+			n++;
+		}
+		if (dc)
+			for (i = 0; i < p->nterm; i++) {
+				int s = p->term[i].s;
+				if (p->term[i].id == a && pos[a][s] == i && s + d >= p->bits)
+					pos[a][s] = MAX_ID * 2, n++;
+			}
+		if (n < 2) {
+			if (nban == 64) break;
+			ban[nban][0] = a; ban[nban][1] = b; ban[nban][2] = d;
+			nban++;
+			continue;
+		}
+
+		/* substitute */
+		p->def[p->ndef].a = a;
+		p->def[p->ndef].b = b;
+		p->def[p->ndef].d = d;
+		p->ndef++;
+		for (i = j = 0; i < p->nterm; i++) {
+			term_t t = p->term[i];
+			int q = pos[t.id][t.s];
+			if (q >= MAX_ID) {
+				if (t.id == a && q != MAX_ID + i) t.id = p->ndef;
+				else continue;
+			}
+			p->term[j++] = t;
+		}
+		p->nterm = j;
+	}
+}
+
+/* multiplication of shift patterns, bits above the register are lost */
+static uint64_t pmul(uint64_t a, uint64_t b, int bits) {
+	uint64_t r = 0, m = ~(uint64_t)0 >> (64 - bits);
+	for (; b; b >>= 1, a <<= 1)
+		if (b & 1) r ^= a;
+	return r & m;
+}
+
+static uint64_t pinv(uint64_t a, int bits) {
+	uint64_t x = 1; int i;
+	for (i = 1; i < bits; i++)
+		if (pmul(a, x, bits) >> i & 1) x |= (uint64_t)1 << i;
+	return x;
+}
+
+static int popcount64(uint64_t a) {
+	int n = 0;
+	for (; a; a &= a - 1) n++;
+	return n;
+}
+
+static void search_run(prog_t *best, prog_t *init, int iter, int *first) {
+	prog_t p; int it;
+	for (it = 0; it <= iter; it++) {
+		p = *init;
+		search_once(&p, it != 0);
+		if (*first || prog_cost(&p) < prog_cost(best) ||
+				(prog_cost(&p) == prog_cost(best) && p.ndef < best->ndef))
+			*best = p, *first = 0;
+	}
+}
+
+#define NFACTOR 16
+
+/*
+ * Plain elimination, then the same with a sparse factor taken out
+ * first: t = x ^ x << a ^ x << b, and the rest is a multiple of t.
+ */
+static void search(prog_t *best, int dir, int bits, uint64_t t) {
+	prog_t p; int i, a, b, n, first = 1;
+	uint64_t fac[NFACTOR]; int fw[NFACTOR], nfac = 0;
+
+	memset(best, 0, sizeof(*best));
+	memset(&p, 0, sizeof(p));
+	p.dir = dir; p.bits = bits;
+	for (i = 0; i < bits; i++)
+		if (t >> i & 1) p.term[p.nterm++].s = i;
+	search_run(best, &p, iterations, &first);
+
+	for (a = 1; a < bits; a++)
+	for (b = a; b < bits; b++) {
+		uint64_t f = 1 | (uint64_t)1 << a | (uint64_t)(a != b) << b;
+		n = popcount64(pmul(t, pinv(f, bits), bits));
+		if (nfac < NFACTOR) fac[nfac] = f, fw[nfac++] = n;
+		else if (n < fw[NFACTOR - 1]) fac[NFACTOR - 1] = f, fw[NFACTOR - 1] = n;
+		else continue;
+		for (i = nfac - 1; i > 0 && fw[i] < fw[i - 1]; i--) {
+			uint64_t tf = fac[i]; int tw = fw[i];
+			fac[i] = fac[i - 1]; fw[i] = fw[i - 1];
+			fac[i - 1] = tf; fw[i - 1] = tw;
+		}
+	}
+	for (i = 0; i < nfac; i++) {
+		uint64_t q = pmul(t, pinv(fac[i], bits), bits);
+		memset(&p, 0, sizeof(p));
+		p.dir = dir; p.bits = bits;
+		for (a = 1; a < bits; a++)
+			if (fac[i] >> a & 1) {
+				p.def[p.ndef].a = p.ndef ? p.ndef : 0;
+				p.def[p.ndef].b = 0;
+				p.def[p.ndef++].d = a;
+			}
+		for (a = 0; a < bits; a++)
+			if (q >> a & 1) {
+				p.term[p.nterm].id = p.ndef;
+				p.term[p.nterm++].s = a;
+			}
+		search_run(best, &p, iterations / NFACTOR, &first);
+	}
+}
+
+/* clmul(x, k) (low half) or clmul_hi(x, k) of x with the given width */
+static void search_mul(prog_t *best, int hi, int bits, int xbits, uint64_t k) {
+	uint64_t t = 0; int i;
+	for (i = 0; i < xbits; i++)
+		if (k >> i & 1) {
+			if (!hi) t |= (uint64_t)1 << i;
+			else if (i) t |= (uint64_t)1 << (xbits - i);
+		}
+	search(best, hi, bits, t);
+}
+
+static uint64_t ref_mul(int hi, int bits, int xbits, uint64_t x, uint64_t k) {
+	uint64_t r = 0, m = ~(uint64_t)0 >> (64 - bits); int i;
+	x &= ~(uint64_t)0 >> (64 - xbits);
+	for (i = 0; i < xbits; i++)
+		if (k >> i & 1) {
+			if (!hi) r ^= x << i;
+			else if (i) r ^= x >> (xbits - i);
+		}
+	return r & m;
+}
+
+static int verify_mul(const prog_t *p, int hi, int xbits, uint64_t k) {
+	int i;
+	for (i = 0; i < 10000; i++) {
+		uint64_t x = rng() & (~(uint64_t)0 >> (64 - xbits));
+		if (i < 64) x = (uint64_t)1 << (i % xbits);
+		if (prog_eval(p, x) != ref_mul(hi, p->bits, xbits, x, k)) {
+			fprintf(stderr, "!!! verification failed for 0x%llx\n",
+					(unsigned long long)k);
+			exit(1);
+		}
+	}
+	return 0;
+}
+
+static int print_nsh, print_sh[MAX_ID + 64][3];
+
+static int print_ref(int id, int s, const char *in, const char *tmp,
+		const char *sh) {
+	int i, n;
+	if (s)
+		for (i = 0; i < print_nsh; i++)
+			if (print_sh[i][0] == id && print_sh[i][1] == s) {
+				if (print_sh[i][2] >= 0)
+					return printf("%s%d", tmp, print_sh[i][2]);
+				break;
+			}
+	if (!id) n = printf("%s", in);
+	else n = printf("%s%d", tmp, id - 1);
+	if (s) n += printf("%s%d", sh, s);
+	return n;
+}
+
+/*
+ * Prints one statement per line inside a macro, the result is
+ * stored with "out o expr".
+ */
+static void print_prog(const prog_t *p, const char *in, const char *tmp,
+		const char *out, const char *o) {
+	const char *sh = p->dir ? ">>" : "<<";
+	int i, j, col = 0, ntmp = p->ndef, cnt[MAX_ID + 64];
+	int (*shv)[3] = print_sh;
+
+#define PRINT_SEP if (++col == 3) printf(" \\\n"), col = 0; else printf(" ");
+	/* shifted values used twice get a temporary */
+	print_nsh = 0;
+	{
+		int tmpsh[MAX_ID + 64][2];
+		print_nsh = prog_shared(p, tmpsh);
+		for (i = 0; i < print_nsh; i++) {
+			shv[i][0] = tmpsh[i][0]; shv[i][1] = tmpsh[i][1];
+			shv[i][2] = -1; cnt[i] = 0;
+		}
+		for (i = 0; i < p->ndef + p->nterm; i++) {
+			int id, s;
+			if (i < p->ndef) id = p->def[i].b, s = p->def[i].d;
+			else id = p->term[i - p->ndef].id, s = p->term[i - p->ndef].s;
+			for (j = 0; j < print_nsh; j++)
+				if (shv[j][0] == id && shv[j][1] == s) cnt[j]++;
+		}
+	}
+
+	printf("\t/* shift = %d, xor = %d%s */ \\\n",
+			prog_shifts(p), prog_xors(p), strcmp(o, "=") ? "(+1)" : "");
+	for (i = 0; i <= p->ndef; i++) {
+		if (i) {
+			const def_t *d = &p->def[i - 1];
+			if (!col) printf("\t");
+			printf("%s%d = ", tmp, i - 1);
+			print_ref(d->a, 0, in, tmp, sh);
+			printf("^");
+			print_ref(d->b, d->d, in, tmp, sh);
+			printf(";");
+			PRINT_SEP
+		}
+		for (j = 0; j < print_nsh; j++) {
+			int k = shv[j][0];
+			if (k != i || cnt[j] < 2) continue;
+			if (!col) printf("\t");
+			printf("%s%d = ", tmp, ntmp);
+			print_ref(k, shv[j][1], in, tmp, sh);
+			printf(";");
+			PRINT_SEP
+			shv[j][2] = ntmp++;
+		}
+	}
+#undef PRINT_SEP
+	if (col) printf("\\\n");
+	col = printf("\t%s %s ", out, o);
+	if (!p->nterm) printf("0");
+	for (i = 0; i < p->nterm; i++) {
+		if (col > 60) printf(" \\\n\t"), col = 0;
+		if (i) col += printf("^");
+		col += print_ref(p->term[i].id, p->term[i].s, in, tmp, sh);
+	}
+	printf(";");
+}
+
+static void print_temps(const char *type, const char *tmp, int n) {
+	int i;
+	if (!n) return;
+	printf("\t%s", type);
+	for (i = 0; i < n; i++)
+		printf("%s%s%d", i ? ", " : " ", tmp, i);
+	printf(";\n");
+}
+
+static void print_stats(const char *name, const prog_t *p, int nprog) {
+	int i, s = 0, x = 0;
+	for (i = 0; i < nprog; i++) {
+		s += prog_shifts(&p[i]);
+		x += prog_xors(&p[i]);
+	}
+	printf(" * %s: shift = %d, xor = %d\n", name, s, x);
+}
+
+static const char *crc32_body =
+"	uintptr_t r = (uintptr_t)s & 7;\n"
+"	const uint64_t *b;\n"
+"	uint64_t f, h;\n"
+"	if (!n) return c;\n"
+"	c = ~c;\n"
+"	b = (const uint64_t*)((uintptr_t)s & -8);\n"
+"	if (n <= 8) {\n"
+"		f = c; n <<= 3; v = f >> 8 >> (n - 8);\n"
+"		if (r + n < 8)\n"
+"			f = (f ^ *b >> r * 8) << (64 - n);\n"
+"		else\n"
+"			f = (f ^ *(const uint64_t*)s) << (64 - n);\n"
+"	} else {\n"
+"		n += r;\n"
+"		h = c;\n"
+"		f = (h ^ *b++ >> r * 8) << (r * 8);\n"
+"		h = h >> 8 >> (56 - r * 8);\n"
+"		for (; n > 16; n -= 8) {\n"
+"			FOLD2(^=)\n"
+"			FOLD3(f >> 32, ^=)\n"
+"			f = h ^ *b++;\n"
+"			h = 0;\n"
+"		}\n"
+"		h ^= *b++;\n"
+"		n <<= 3;\n"
+"		h <<= 64*2 - n;\n"
+"		h ^= f >> 8 >> (n - 8 - 64);\n"
+"		f <<= 64*2 - n;\n"
+"		FOLD2(^=)\n"
+"		FOLD3(f >> 32, ^=)\n"
+"		f = h;\n"
+"		v = 0;\n"
+"	}\n"
+"	h = f >> 32;\n"
+"	FOLD3((uint32_t)f, ^=)\n"
+"	c = h; v ^= h >> 32;\n"
+"	FOLD1(c)\n"
+"	c ^= x ^ v;\n"
+"	return ~c;\n"
+"#undef FOLD1\n"
+"#undef FOLD2\n"
+"#undef FOLD3\n"
+"}\n";
+
+static const char *crc64_body =
+"	uintptr_t r = (uintptr_t)s & 7, q;\n"
+"	if (!n) return c;\n"
+"	c = ~c;\n"
+"	a = (const uint64_t*)((uintptr_t)s & -8);\n"
+"	if (r) {\n"
+"		n -= q = n >= 8 - r ? 8 - r : n;\n"
+"		q <<= 3; v = c >> q;\n"
+"		c = (c ^ *a++ >> r * 8) << (64 - q);\n"
+"		FOLD1(c) c ^= x ^ v;\n"
+"	}\n"
+"\n"
+"	if (n >= 16) {\n"
+"		c ^= a[0];\n"
+"		x = a[1];\n"
+"		a += 2; n -= 16;\n"
+"		while (n >= 16) {\n"
+"			FOLD2\n"
+"			FOLD3(x, ^=)\n"
+"			c = a[0] ^ v;\n"
+"			x = a[1] ^ w;\n"
+"			a += 2; n -= 16;\n"
+"		}\n"
+"		FOLD3(c, =)\n"
+"		v ^= x;\n"
+"		FOLD1(v)\n"
+"		c ^= x ^ w;\n"
+"	}\n"
+"	if (n >= 8) {\n"
+"		c ^= *a++; FOLD1(c)\n"
+"		c ^= x; n -= 8;\n"
+"	}\n"
+"\n"
+"	if (n) {\n"
+"		n <<= 3; v = c >> n;\n"
+"		c = (c ^ *a++) << (64 - n);\n"
+"		FOLD1(c) c ^= x ^ v;\n"
+"	}\n"
+"#undef FOLD1\n"
+"#undef FOLD2\n"
+"#undef FOLD3\n"
+"	return ~c;\n"
+"}\n";
+
+static void gen_crc32(uint32_t p, const char *name) {
+	uint32_t i0 = p << 1;
+	uint32_t i1 = calc_lo(p, 1, 32);
+	uint32_t i2 = calc_hi(p, 1, 32);
+	uint32_t i3 = calc_hi(p, i2, 32);
+	prog_t f1[2], f2, f3;
+	int n32, n64, s, x;
+
+	search_mul(&f1[0], 0, 32, 32, i1); verify_mul(&f1[0], 0, 32, i1);
+	search_mul(&f1[1], 1, 32, 32, i0); verify_mul(&f1[1], 1, 32, i0);
+	search_mul(&f2, 0, 64, 32, i3); verify_mul(&f2, 0, 32, i3);
+	search_mul(&f3, 0, 64, 32, i2); verify_mul(&f3, 0, 32, i2);
+
+	/* main loop: FOLD2 + FOLD3 and one xor per 8 bytes */
+	s = prog_shifts(&f2) + prog_shifts(&f3);
+	x = prog_xors(&f2) + prog_xors(&f3) + 3;
+	printf("/*\n * Generated by clsim_gen, poly = 0x%08x\n", p);
+	print_stats("FOLD1", f1, 2);
+	print_stats("FOLD2", &f2, 1);
+	print_stats("FOLD3", &f3, 1);
+	printf(" * main loop: %.3f ops/byte, ~%.3f cycles/byte at IPC %g\n */\n",
+			(s + x) / 8.0, (s + x) / 8.0 / ipc, ipc);
+
+	printf("uint32_t %s(const uint8_t *s, size_t n, uint32_t c) {\n", name);
+	printf("\tuint32_t x, v;\n");
+	printf("\t// uint32_t p = 0x%08x;\n", p);
+	printf("\t// i0 = 0x%08x; // p << 1\n", i0);
+	printf("\t// i1 = 0x%08x; // calc_lo(p, 1, 32)\n", i1);
+	printf("\t// i2 = 0x%08x; // calc_hi(p, 1, 32)\n", i2);
+	printf("\t// i3 = 0x%08x; // calc_hi(p, i2, 32)\n", i3);
+	n32 = prog_temps(&f1[0]);
+	if (n32 < prog_temps(&f1[1])) n32 = prog_temps(&f1[1]);
+	n64 = prog_temps(&f2);
+	if (n64 < prog_temps(&f3)) n64 = prog_temps(&f3);
+	print_temps("uint32_t", "t", n32);
+	printf("\tuint64_t g;\n");
+	print_temps("uint64_t", "tt", n64);
+	printf("#define FOLD1(v) \\\n");
+	print_prog(&f1[0], "v", "t", "x", "="); printf(" \\\n");
+	print_prog(&f1[1], "x", "t", "c", "="); printf("\n");
+	printf("#define FOLD2(o) \\\n\tg = (uint32_t)f; \\\n");
+	print_prog(&f2, "g", "tt", "h", "o"); printf("\n");
+	printf("#define FOLD3(x, o) \\\n\tg = x; \\\n");
+	print_prog(&f3, "g", "tt", "h", "o"); printf("\n\n");
+	printf("%s", crc32_body);
+}
+
+static void gen_crc64(uint64_t p, const char *name) {
+	uint64_t i0 = p << 1;
+	uint64_t i1 = calc_lo(p, 1, 64);
+	uint64_t i2 = calc_hi(p, 1, 64);
+	uint64_t i3 = calc_hi(p, i2, 64);
+	prog_t f1[6], *f2 = f1 + 2, *f3 = f1 + 4;
+	int i, n, s, x;
+
+	search_mul(&f1[0], 0, 64, 64, i1); verify_mul(&f1[0], 0, 64, i1);
+	search_mul(&f1[1], 1, 64, 64, i0); verify_mul(&f1[1], 1, 64, i0);
+	search_mul(&f2[0], 0, 64, 64, i3); verify_mul(&f2[0], 0, 64, i3);
+	search_mul(&f2[1], 1, 64, 64, i3); verify_mul(&f2[1], 1, 64, i3);
+	search_mul(&f3[0], 0, 64, 64, i2); verify_mul(&f3[0], 0, 64, i2);
+	search_mul(&f3[1], 1, 64, 64, i2); verify_mul(&f3[1], 1, 64, i2);
+
+	/* main loop: FOLD2 + FOLD3 and two xors per 16 bytes */
+	s = prog_shifts(&f2[0]) + prog_shifts(&f2[1]) +
+			prog_shifts(&f3[0]) + prog_shifts(&f3[1]);
+	x = prog_xors(&f2[0]) + prog_xors(&f2[1]) +
+			prog_xors(&f3[0]) + prog_xors(&f3[1]) + 4;
+	printf("/*\n * Generated by clsim_gen, poly = 0x%016llx\n",
+			(unsigned long long)p);
+	print_stats("FOLD1", f1, 2);
+	print_stats("FOLD2", f2, 2);
+	print_stats("FOLD3", f3, 2);
+	printf(" * main loop: %.3f ops/byte, ~%.3f cycles/byte at IPC %g\n */\n",
+			(s + x) / 16.0, (s + x) / 16.0 / ipc, ipc);
+
+	printf("uint64_t %s(const uint8_t *s, size_t n, uint64_t c) {\n", name);
+	printf("\tuint64_t x, v, w; const uint64_t *a;\n");
+	printf("\t// uint64_t p = 0x%016llx;\n", (unsigned long long)p);
+	printf("\t// i0 = 0x%016llx; // p << 1\n", (unsigned long long)i0);
+	printf("\t// i1 = 0x%016llx; // calc_lo(p, 1, 64)\n", (unsigned long long)i1);
+	printf("\t// i2 = 0x%016llx; // calc_hi(p, 1, 64)\n", (unsigned long long)i2);
+	printf("\t// i3 = 0x%016llx; // calc_hi(p, i2, 64)\n", (unsigned long long)i3);
+	for (n = i = 0; i < 6; i++)
+		if (n < prog_temps(&f1[i])) n = prog_temps(&f1[i]);
+	print_temps("uint64_t", "t", n);
+	printf("#define FOLD1(v) \\\n");
+	print_prog(&f1[0], "v", "t", "x", "="); printf(" \\\n");
+	print_prog(&f1[1], "x", "t", "c", "="); printf("\n");
+	printf("#define FOLD2 \\\n");
+	print_prog(&f2[0], "c", "t", "v", "="); printf(" \\\n");
+	print_prog(&f2[1], "c", "t", "w", "="); printf("\n");
+	printf("#define FOLD3(x, o) \\\n");
+	print_prog(&f3[0], "x", "t", "v", "o"); printf(" \\\n");
+	print_prog(&f3[1], "x", "t", "w", "o"); printf("\n\n");
+	printf("%s", crc64_body);
+}
+
+static void gen_const(uint64_t k, int bits, const char *name) {
+	prog_t lo, hi;
+	int n;
+
+	search_mul(&lo, 0, bits, bits, k); verify_mul(&lo, 0, bits, k);
+	search_mul(&hi, 1, bits, bits, k); verify_mul(&hi, 1, bits, k);
+	printf("/* x * 0x%0*llx, generated by clsim_gen */\n",
+			bits / 4, (unsigned long long)k);
+	n = prog_temps(&lo);
+	if (n < prog_temps(&hi)) n = prog_temps(&hi);
+	if (n) printf("/* temps: t0..t%d */\n", n - 1);
+	printf("#define %s_LO(x, r, o) \\\n", name);
+	print_prog(&lo, "x", "t", "r", "o"); printf("\n");
+	printf("#define %s_HI(x, r, o) \\\n", name);
+	print_prog(&hi, "x", "t", "r", "o"); printf("\n");
+}
+
+/* full 32x32 -> 64 product, as in FOLD2/FOLD3 of crc32_clsim */
+static void gen_const32(uint64_t k, const char *name) {
+	prog_t f;
+
+	search_mul(&f, 0, 64, 32, k); verify_mul(&f, 0, 32, k);
+	printf("/* x * 0x%08llx (64-bit result), generated by clsim_gen */\n",
+			(unsigned long long)k);
+	if (prog_temps(&f)) printf("/* temps: t0..t%d */\n", prog_temps(&f) - 1);
+	printf("#define %s(x, r, o) \\\n", name);
+	print_prog(&f, "x", "t", "r", "o"); printf("\n");
+}
+
+int main(int argc, char **argv) {
+	uint64_t poly = 0, k = 0;
+	int bits = 0, dist = 0, have_k = 0;
+	const char *name = NULL;
+
+	while (argc > 1) {
+		if (argc > 2 && !strcmp(argv[1], "-p")) {
+			poly = strtoull(argv[2], NULL, 0);
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-k")) {
+			k = strtoull(argv[2], NULL, 0); have_k = 1;
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-d")) {
+			dist = atoi(argv[2]);
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-w")) {
+			bits = atoi(argv[2]);
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-f")) {
+			name = argv[2];
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-s")) {
+			cost_shift = atoi(argv[2]);
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-x")) {
+			cost_xor = atoi(argv[2]);
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-r")) {
+			host_bits = atoi(argv[2]);
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-n")) {
+			iterations = atoi(argv[2]);
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-i")) {
+			ipc = atof(argv[2]);
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-S")) {
+			rng_state = strtoull(argv[2], NULL, 0) | 1;
+			argc -= 2; argv += 2;
+		} else {
+			fprintf(stderr,
+"Usage: clsim_gen [options] -p poly | -k const\n"
+"  -p poly   reflected polynomial (e.g. 0xedb88320)\n"
+"  -k const  generate CLMUL_LO/CLMUL_HI macros for a raw constant\n"
+"  -d n      with -p: macros for the fold constant calc_hi(p, 1, n),\n"
+"            a single 64-bit product macro for 32-bit polynomials\n"
+"  -w 32|64  width (default: from the polynomial)\n"
+"  -f name   function or macro name\n"
+"  -s cost   cost of a shift (default 1)\n"
+"  -x cost   cost of a xor (default 1)\n"
+"  -r 32|64  host register width (default 64)\n"
+"  -n num    search iterations (default 1000)\n"
+"  -i ipc    shift/xor per cycle, for the estimate (default 4)\n"
+"  -S seed   random seed\n");
+			return 1;
+		}
+	}
+
+	if (!bits) bits = (poly | k) >> 32 ? 64 : 32;
+	if ((bits != 32 && bits != 64) || (host_bits != 32 && host_bits != 64))
+		return 1;
+
+	if (dist) {
+		if (!poly) return 1;
+		k = calc_hi(poly, 1, dist);
+		have_k = 1;
+	}
+	if (dist && bits == 32) {
+		gen_const32(k, name ? name : "CLMUL");
+	} else if (have_k) {
+		gen_const(k, bits, name ? name : "CLMUL");
+	} else if (!poly) {
+		return 1;
+	} else if (bits == 32) {
+		gen_crc32(poly, name ? name : "crc32_clsim");
+	} else {
+		gen_crc64(poly, name ? name : "crc64_clsim");
+	}
+	return 0;
+}
@@ -0,0 +1,15 @@
+/*
+ * crc32/64_clmul (PMULL) and crc32_arm for the runtime dispatch.
+ * cc -O3 -march=armv8-a+crc+crypto -c crc_arm64.c
+ */
+
+#if !defined(__aarch64__) || !defined(__ARM_FEATURE_CRC32) || \
+		!(defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#error "build for AArch64 with -march=armv8-a+crc+crypto"
+#endif
+
+#define crc32_clmul crc32_clmul_armv8
+#define crc64_clmul crc64_clmul_armv8
+#define crc32_arm crc32_arm_armv8
+#include "crc_clmul.h"
+#include "crc_hwcrc.h"
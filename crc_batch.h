@@ -0,0 +1,201 @@
+/*
+ * CRC32 (PKZIP) and CRC64 (XZ) of many independent messages, with
+ * CRC_BATCH_LANES messages folded at once in separate registers to hide
+ * the CLMUL latency. The messages are sorted by block count, so the
+ * lanes of a group end together; the ones that don't gain from it go
+ * through the kernel one at a time.
+ *
+ * Each message is padded with leading zeros to whole 16-byte blocks, so
+ * unequal lengths only differ in the block count. Messages shorter than
+ * 16 bytes go through a small buffer, with the ~0 initial value replaced
+ * by the equivalent prefix ~0 * x^-W mod P, as it may be longer than the
+ * message itself.
+ *
+ * Requires "crc_clmul.h" for the kernels and reduction (x86 only).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef CRC_BATCH_LANES
+#define CRC_BATCH_LANES 4
+#endif
+
+/* longer messages go through crc_clmul.h one at a time */
+#ifndef CRC_BATCH_MAX
+#define CRC_BATCH_MAX 512
+#endif
+
+/* equal lengths up to this go through crc_clmul.h one at a time */
+#ifndef CRC_BATCH_MIN
+#define CRC_BATCH_MIN 64
+#endif
+
+/* messages sorted at once, at most 65536 */
+#define CRC_BATCH_CHUNK 256
+
+/* shifts bytes up by n with crc_batch_shuf + 16 - n, down by 16 - n with + 32 - n */
+static const uint8_t crc_batch_shuf[48] = {
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80
+};
+
+#define CRC_BATCH_FOLD(x, y) \
+	x = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, vfold16, 0x00), \
+			_mm_clmulepi64_si128(x, vfold16, 0x11)), y);
+
+/* the first one or two blocks of message j in lane k */
+#define CRC_BATCH_START(k, j, W, vinit, prefix) { \
+	const uint8_t *d = bufs[j]; size_t len = lens[j]; \
+	if (len >= 16) { \
+		unsigned skip = -len & 15; \
+		__m128i sh = _mm_loadu_si128((const __m128i*)(crc_batch_shuf + 16 - skip)); \
+		/* the init value may cross into the second block */ \
+		x[k] = _mm_shuffle_epi8(_mm_xor_si128( \
+				_mm_loadu_si128((const __m128i*)d), vinit), sh); \
+		p[k] = d + 16 - skip; rem[k] = (len + skip) / 16 - 1; \
+		if (skip) { \
+			sh = _mm_loadu_si128((const __m128i*)(crc_batch_shuf + 32 - skip)); \
+			CRC_BATCH_FOLD(x[k], _mm_xor_si128(_mm_shuffle_epi8(vinit, sh), \
+					_mm_loadu_si128((const __m128i*)p[k]))) \
+			p[k] += 16; rem[k]--; \
+		} \
+	} else { \
+		uint8_t *t = tmp[k]; \
+		memset(t, 0, 32); \
+		memcpy(t + 32 - len, d, len); \
+		memcpy(t + 32 - len - W, &prefix, W); \
+		if (len + W <= 16) x[k] = _mm_loadu_si128((const __m128i*)(t + 16)), rem[k] = 0; \
+		else x[k] = _mm_loadu_si128((const __m128i*)t), p[k] = t + 16, rem[k] = 1; \
+	} \
+}
+
+#ifdef __GNUC__
+#define CRC_BATCH_NOINLINE __attribute__((noinline))
+#else
+#define CRC_BATCH_NOINLINE
+#endif
+
+/*
+ * the run of messages as long as the first, and the messages in idx[],
+ * apart so the kernel is inlined
+ */
+#define CRC_BATCH_RUN(T, kernel) \
+	size_t i, n = lens[0]; \
+	for (i = 0; i < count && lens[i] == n; i++) out[i] = kernel(bufs[i], n, 0); \
+	return i;
+
+#define CRC_BATCH_EACH(T, kernel) \
+	size_t i; \
+	for (i = 0; i < count; i++) out[idx[i]] = kernel(bufs[idx[i]], lens[idx[i]], 0);
+
+static CRC_BATCH_NOINLINE size_t crc32_clmul_run(const uint8_t **bufs, const size_t *lens, uint32_t *out, size_t count) {
+	CRC_BATCH_RUN(uint32_t, crc32_clmul)
+}
+
+static CRC_BATCH_NOINLINE size_t crc64_clmul_run(const uint8_t **bufs, const size_t *lens, uint64_t *out, size_t count) {
+	CRC_BATCH_RUN(uint64_t, crc64_clmul)
+}
+
+static CRC_BATCH_NOINLINE void crc32_clmul_each(const uint8_t **bufs, const size_t *lens, uint32_t *out,
+		const uint16_t *idx, size_t count) {
+	CRC_BATCH_EACH(uint32_t, crc32_clmul)
+}
+
+static CRC_BATCH_NOINLINE void crc64_clmul_each(const uint8_t **bufs, const size_t *lens, uint64_t *out,
+		const uint16_t *idx, size_t count) {
+	CRC_BATCH_EACH(uint64_t, crc64_clmul)
+}
+
+/*
+ * per chunk: the long messages through the kernel, a counting sort of
+ * the others by block count, then groups of CRC_BATCH_LANES neighbours
+ */
+#define CRC_BATCH_BODY(W, vinit, prefix, reduce, run, each) \
+	uint16_t order[CRC_BATCH_CHUNK], rest[CRC_BATCH_CHUNK]; \
+	unsigned pos[CRC_BATCH_MAX / 16 + 2]; \
+	const uint8_t *p[CRC_BATCH_LANES]; \
+	size_t rem[CRC_BATCH_LANES], i, j, n, base, m, sorted, nrest, kmin, kmax; \
+	uint8_t tmp[CRC_BATCH_LANES][32]; \
+	__m128i x[CRC_BATCH_LANES]; \
+	int k; \
+	\
+	for (base = 0; base < count; base += m) { \
+		/* a run of equal short lengths, which the kernel predicts well */ \
+		if (lens[base] <= CRC_BATCH_MIN) \
+			base += run(bufs + base, lens + base, out + base, count - base); \
+		m = count - base < CRC_BATCH_CHUNK ? count - base : CRC_BATCH_CHUNK; \
+		for (sorted = nrest = 0, kmin = (size_t)-1, kmax = 0, i = base; i < base + m; i++) \
+			if (lens[i] > CRC_BATCH_MAX) rest[nrest++] = (uint16_t)(i - base); \
+			else { \
+				order[sorted++] = (uint16_t)(i - base); \
+				if (lens[i] < kmin) kmin = lens[i]; \
+				if (lens[i] > kmax) kmax = lens[i]; \
+			} \
+		if (sorted && (kmin + 15) / 16 != (kmax + 15) / 16) { \
+			memset(pos, 0, sizeof(pos)); \
+			for (i = 0; i < sorted; i++) pos[(lens[base + order[i]] + 15) / 16 + 1]++; \
+			for (i = 1; i < CRC_BATCH_MAX / 16 + 2; i++) pos[i] += pos[i - 1]; \
+			for (i = base; i < base + m; i++) \
+				if (lens[i] <= CRC_BATCH_MAX) \
+					order[pos[(lens[i] + 15) / 16]++] = (uint16_t)(i - base); \
+		} \
+		for (i = 0; i + CRC_BATCH_LANES <= sorted; i += CRC_BATCH_LANES) { \
+			for (k = 0; k < CRC_BATCH_LANES; k++) \
+				CRC_BATCH_START(k, base + order[i + k], W, vinit, prefix) \
+			for (n = rem[0], k = 1; k < CRC_BATCH_LANES; k++) \
+				if (rem[k] < n) n = rem[k]; \
+			/* all lanes in step, in registers */ \
+			{ \
+				__m128i y[CRC_BATCH_LANES]; const uint8_t *q[CRC_BATCH_LANES]; \
+				for (k = 0; k < CRC_BATCH_LANES; k++) y[k] = x[k], q[k] = p[k]; \
+				for (j = 0; j < n; j++) \
+					for (k = 0; k < CRC_BATCH_LANES; k++) { \
+						CRC_BATCH_FOLD(y[k], _mm_loadu_si128((const __m128i*)q[k])) \
+						q[k] += 16; \
+					} \
+				for (k = 0; k < CRC_BATCH_LANES; k++) x[k] = y[k], p[k] = q[k]; \
+			} \
+			/* the rest of the longer ones, at bucket edges only */ \
+			for (k = 0; k < CRC_BATCH_LANES; k++) { \
+				for (j = n; j < rem[k]; j++, p[k] += 16) \
+					CRC_BATCH_FOLD(x[k], _mm_loadu_si128((const __m128i*)p[k])) \
+				out[base + order[i + k]] = reduce(x[k], _mm_srli_si128(x[k], 8)); \
+			} \
+		} \
+		for (; i < sorted; i++) rest[nrest++] = order[i]; \
+		each(bufs + base, lens + base, out + base, rest, nrest); \
+	}
+
+void crc32_clmul_batch(const uint8_t **bufs, const size_t *lens, uint32_t *out, size_t count) {
+	// uint32_t p = 0xedb88320;
+	uint64_t i3 = 0x0ccaa009e; // calc_hi(p, p, 64) << 1
+	uint64_t i4 = 0x1751997d0; // calc_hi(p, p, 128) << 1
+	uint32_t prefix = 0x9226f562; // ~0 * x^-32 mod P
+	__m128i vfold16 = _mm_set_epi64x(i3, i4);
+	__m128i vinit = _mm_cvtsi32_si128(-1);
+
+	CRC_BATCH_BODY(4, vinit, prefix, crc32_clmul_reduce, crc32_clmul_run, crc32_clmul_each)
+}
+
+void crc64_clmul_batch(const uint8_t **bufs, const size_t *lens, uint64_t *out, size_t count) {
+	// uint64_t p = 0xc96c5795d7870f42;
+	uint64_t i2 = 0xdabe95afc7875f40; // calc_hi(p, 1, 64)
+	uint64_t i3 = 0xe05dd497ca393ae4; // calc_hi(p, i2, 64)
+	uint64_t prefix = 0xf095ec18759f35fa; // ~0 * x^-64 mod P
+	__m128i vfold16 = _mm_set_epi64x(i2, i3);
+	__m128i vinit = _mm_set_epi64x(0, -1);
+
+	CRC_BATCH_BODY(8, vinit, prefix, crc64_clmul_reduce, crc64_clmul_run, crc64_clmul_each)
+}
+
+#undef CRC_BATCH_BODY
+#undef CRC_BATCH_EACH
+#undef CRC_BATCH_RUN
+#undef CRC_BATCH_NOINLINE
+#undef CRC_BATCH_START
+#undef CRC_BATCH_FOLD
@@ -0,0 +1,103 @@
+/*
+ * Buffers for the generated input (-B opts), comma-separated:
+ * arena[=size] a rotating arena (512MB by default, k/m/g suffixes), each
+ *              call takes the next -n bytes of it, so with an arena over
+ *              the LLC size the data comes from DRAM as in production;
+ * 2m, 1g       explicit huge pages (MAP_HUGETLB, see vm.nr_hugepages),
+ *              else 4KB pages (MADV_NOHUGEPAGE, so THP doesn't merge
+ *              them), to see when the TLB matters;
+ * node=N       pages bound to NUMA node N (mbind), e.g. a remote one.
+ * Linux only, without libnuma.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#define CRC_MPOL_BIND 2
+#define CRC_MPOL_MF_STRICT 1
+#define CRC_MPOL_MF_MOVE 2
+
+typedef struct {
+	size_t arena;  /* 0 = one chunk */
+	int huge;      /* 0, 21 or 30: log2 of the page size */
+	int node;      /* -1 = any */
+	size_t size;   /* of the mapping */
+} crc_buffer_t;
+
+static size_t crc_buffer_size(const char *s) {
+	char *e;
+	size_t n = strtoull(s, &e, 0);
+	switch (*e | 0x20) {
+	case 'g': n <<= 10; /* fallthrough */
+	case 'm': n <<= 10; /* fallthrough */
+	case 'k': n <<= 10;
+	}
+	return n;
+}
+
+/* returns non-zero on unknown options */
+static int crc_buffer_opts(crc_buffer_t *b, const char *s) {
+	memset(b, 0, sizeof(*b));
+	b->node = -1;
+	while (*s) {
+		size_t n = strcspn(s, ",");
+		if (!strncmp(s, "arena", 5) && (n == 5 || s[5] == '='))
+			b->arena = n > 5 ? crc_buffer_size(s + 6) : (size_t)512 << 20;
+		else if (n == 2 && !strncmp(s, "2m", 2)) b->huge = 21;
+		else if (n == 2 && !strncmp(s, "1g", 2)) b->huge = 30;
+		else if (!strncmp(s, "node=", 5)) b->node = atoi(s + 5);
+		else return 1;
+		s += n + (s[n] == ',');
+	}
+	return 0;
+}
+
+/* at least size bytes, a whole number of chunks; NULL with a note on failure */
+static uint8_t *crc_buffer_alloc(crc_buffer_t *b, size_t chunk) {
+	size_t size = chunk, page = (size_t)1 << (b->huge ? b->huge : 12);
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	void *p;
+
+	if (b->arena > chunk) size = b->arena / chunk * chunk;
+	b->arena = size;
+	b->size = (size + page - 1) & -page;
+	if (b->huge) flags |= MAP_HUGETLB | b->huge << MAP_HUGE_SHIFT;
+	p = mmap(NULL, b->size, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (p == MAP_FAILED) {
+		printf("!!! can't map %lu bytes%s\n", (unsigned long)b->size,
+				b->huge ? " of huge pages, see vm.nr_hugepages" : "");
+		return NULL;
+	}
+	/* before the pages are touched */
+#ifdef MADV_NOHUGEPAGE
+	if (!b->huge) madvise(p, b->size, MADV_NOHUGEPAGE);
+#endif
+	if (b->node >= 0) {
+		unsigned long mask[16] = { 0 };
+		const int bits = sizeof(mask[0]) * 8;
+		int err = b->node >= (int)(sizeof(mask) * 8);
+		if (!err) {
+			mask[b->node / bits] = 1ul << b->node % bits;
+			err = syscall(SYS_mbind, p, b->size, CRC_MPOL_BIND, mask,
+					sizeof(mask) * 8, CRC_MPOL_MF_STRICT | CRC_MPOL_MF_MOVE) != 0;
+		}
+		if (err) {
+			printf("!!! mbind to node %i failed\n", b->node);
+			munmap(p, b->size);
+			return NULL;
+		}
+	}
+	return (uint8_t*)p;
+}
+
+static void crc_buffer_free(crc_buffer_t *b, uint8_t *p) {
+	munmap(p, b->size);
+}
@@ -51,6 +51,27 @@ static uint64_t calc_hi(uint64_t p, uint64_t a, int n) {
 	v1 = veorq_u8(v1, PMULL1(v0, low, vfold16, low)); \
 	v0 = veorq_u8(v1, PMULL2(v0, vfold16));
 
+#define FOLD4(v, k) \
+	v = veorq_u8(veorq_u8(PMULL1(v, low, vfold64, low), \
+			PMULL2(v, vfold64)), vld1q_u8(adata + k * 16));
+
+/* four independent streams, 64 bytes per iteration */
+#define CRC_SIMD_LOOP4 \
+	if (length2 >= 256) { \
+		v2 = vld1q_u8(adata + 16); \
+		v3 = vld1q_u8(adata + 32); \
+		adata += 48; \
+		length2 -= 32; \
+		do { \
+			FOLD4(v0, 0) FOLD4(v1, 1) FOLD4(v2, 2) FOLD4(v3, 3) \
+			adata += 64; \
+			length2 -= 64; \
+		} while (length2 >= 96); \
+		FOLD v1 = v2; \
+		FOLD v1 = v3; \
+		adata -= 16; \
+	}
+
 #define CRC_SIMD_BODY \
 	uintptr_t skipS = (uintptr_t)data & 15; \
 	uintptr_t skipE = -(uintptr_t)(data + length) & 15; \
@@ -88,6 +109,7 @@ static uint64_t calc_hi(uint64_t p, uint64_t a, int n) {
 			MASK_LH(vcrc, maskS, v0, v1) \
 			v0 = veorq_u8(v0, data0); \
 			v1 = veorq_u8(v1, data1); \
+			CRC_SIMD_LOOP4 \
 			while (length2 > 32) { \
 				adata += 16; \
 				length2 -= 16; \
@@ -112,10 +134,13 @@ uint32_t crc32_clmul(const uint8_t *data, size_t length, uint32_t crc) {
 	uint64_t i2 = 0x163cd6124; // calc_hi(p, p, 32) << 1
 	uint64_t i3 = 0x0ccaa009e; // calc_hi(p, p, 64) << 1
 	uint64_t i4 = 0x1751997d0; // calc_hi(p, p, 128) << 1
+	uint64_t i5 = 0x1c6e41596; // calc_hi(p, p, 448) << 1
+	uint64_t i6 = 0x154442bd4; // calc_hi(p, p, 512) << 1
 
 	uint8x16_t vfold4 = vcombine_u8(vcreate_u8(i0), vcreate_u8(i1));
 	uint8x16_t vfold8 = vcombine_u8(vcreate_u8(i2), vcreate_u8(0));
 	uint8x16_t vfold16 = vcombine_u8(vcreate_u8(i4), vcreate_u8(i3));
+	uint8x16_t vfold64 = vcombine_u8(vcreate_u8(i6), vcreate_u8(i5));
 
 	CRC_SIMD_BODY
 
@@ -137,9 +162,12 @@ uint64_t crc64_clmul(const uint8_t *data, size_t length, uint64_t crc) {
 	uint64_t i1 = 0x9c3e466c172963d5; // calc_lo(p, 1, 64)
 	uint64_t i2 = 0xdabe95afc7875f40; // calc_hi(p, 1, 64)
 	uint64_t i3 = 0xe05dd497ca393ae4; // calc_hi(p, i2, 64)
+	uint64_t i4 = 0x081f6054a7842df4; // calc_hi(p, 1, 448)
+	uint64_t i5 = 0x6ae3efbb9dd441f3; // calc_hi(p, 1, 512)
 
 	uint8x16_t vfold8 = vcombine_u8(vcreate_u8(i1), vcreate_u8(i0));
 	uint8x16_t vfold16 = vcombine_u8(vcreate_u8(i3), vcreate_u8(i2));
+	uint8x16_t vfold64 = vcombine_u8(vcreate_u8(i5), vcreate_u8(i4));
 
 	CRC_SIMD_BODY
 
@@ -151,7 +179,9 @@ uint64_t crc64_clmul(const uint8_t *data, size_t length, uint64_t crc) {
 	return ~vgetq_lane_u64(vreinterpretq_u64_u8(v0), 1);
 }
 
+#undef CRC_SIMD_LOOP4
 #undef CRC_SIMD_BODY
+#undef FOLD4
 #undef FOLD
 
 #elif defined(__SSE4_1__) && defined(__PCLMUL__)
@@ -168,21 +198,47 @@ uint64_t crc64_clmul(const uint8_t *data, size_t length, uint64_t crc) {
 	v1 = _mm_xor_si128(v1, _mm_clmulepi64_si128(v0, vfold16, 0x00)); \
 	v0 = _mm_xor_si128(v1, _mm_clmulepi64_si128(v0, vfold16, 0x11));
 
+#define FOLD4(v, k) \
+	v = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(v, vfold64, 0x00), \
+			_mm_clmulepi64_si128(v, vfold64, 0x11)), _mm_load_si128(adata + k));
+
+/* four independent streams, 64 bytes per iteration */
+#define CRC_SIMD_LOOP4 \
+	if ((const char*)end - (const char*)adata >= 256) { \
+		v2 = _mm_load_si128(adata); \
+		v3 = _mm_load_si128(adata + 1); \
+		adata += 2; \
+		do { \
+			FOLD4(v0, 0) FOLD4(v1, 1) FOLD4(v2, 2) FOLD4(v3, 3) \
+			adata += 4; \
+		} while ((const char*)end - (const char*)adata >= 64); \
+		FOLD v1 = v2; \
+		FOLD v1 = v3; \
+	}
+
 #if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+/* VEX forms with AVX, legacy SSE ones stall when inlined after AVX code */
+#ifdef __AVX__
+#define CRC_SIMD_ASM(op, args, dst) "v" op "\t" args ", " dst ", " dst "\n\t"
+#define CRC_SIMD_MOV "vmovdqa\t"
+#else
+#define CRC_SIMD_ASM(op, args, dst) op "\t" args ", " dst "\n\t"
+#define CRC_SIMD_MOV "movdqa\t"
+#endif
 #define CRC_SIMD_LOOP \
 	if (adata < end) { \
 		__asm__ __volatile__( \
 		".p2align 4,,10\n\t" \
 		".p2align 3\n\t" \
 		"1:\n\t" \
-		"movdqa\t(%[p]), %3\n\t" \
-		"movdqa\t%0, %2\n\t" \
-		"pclmulqdq\t$0x00, %[f], %0\n\t" \
-		"pclmulqdq\t$0x11, %[f], %2\n\t" \
+		CRC_SIMD_MOV "(%[p]), %3\n\t" \
+		CRC_SIMD_MOV "%0, %2\n\t" \
+		CRC_SIMD_ASM("pclmulqdq", "$0x00, %[f]", "%0") \
+		CRC_SIMD_ASM("pclmulqdq", "$0x11, %[f]", "%2") \
 		"lea\t16(%[p]), %[p]\n\t" \
-		"pxor\t%1, %0\n\t" \
-		"pxor\t%2, %0\n\t" \
-		"movdqa\t%3, %1\n\t" \
+		CRC_SIMD_ASM("pxor", "%1", "%0") \
+		CRC_SIMD_ASM("pxor", "%2", "%0") \
+		CRC_SIMD_MOV "%3, %1\n\t" \
 		"cmp\t%[e], %[p]\n\t" \
 		"jb\t1b\n\t" \
 			: "+&x"(v0), "+&x"(v1), "=&x"(v2), "=&x"(v3), \
@@ -234,6 +290,7 @@ uint64_t crc64_clmul(const uint8_t *data, size_t length, uint64_t crc) {
 			MASK_LH(vcrc, maskS, v0, v1) \
 			v0 = _mm_xor_si128(v0, data0); \
 			v1 = _mm_xor_si128(v1, data1); \
+			CRC_SIMD_LOOP4 \
 			CRC_SIMD_LOOP \
 			if (adata != end) { \
 				MASK_H(v0, maskE, v2) \
@@ -246,21 +303,19 @@ uint64_t crc64_clmul(const uint8_t *data, size_t length, uint64_t crc) {
 		} \
 	}
 
-uint32_t crc32_clmul(const uint8_t *data, size_t length, uint32_t crc) {
+/* reduces the last 16 bytes (low half of v0, v1) to the CRC */
+static inline uint32_t crc32_clmul_reduce(__m128i v0, __m128i v1) {
 	// uint32_t p = 0xedb88320;
 	uint64_t i0 = 0x1db710640; // p << 1
 	uint64_t i1 = 0x1f7011641; // calc_lo(p, p, 32) << 1 | 1
 	uint64_t i2 = 0x163cd6124; // calc_hi(p, p, 32) << 1
 	uint64_t i3 = 0x0ccaa009e; // calc_hi(p, p, 64) << 1
-	uint64_t i4 = 0x1751997d0; // calc_hi(p, p, 128) << 1
 
 	__m128i vfold4 = _mm_set_epi64x(i1, i0);
 	__m128i vfold8 = _mm_set_epi64x(0, i2);
-	__m128i vfold16 = _mm_set_epi64x(i3, i4);
+	__m128i v2;
 
-	CRC_SIMD_BODY(_mm_cvtsi32_si128(~crc))
-
-	v1 = _mm_xor_si128(_mm_clmulepi64_si128(v0, vfold16, 0x10), v1); // xxx0
+	v1 = _mm_xor_si128(_mm_clmulepi64_si128(v0, _mm_set_epi64x(0, i3), 0x00), v1); // xxx0
 	v2 = _mm_shuffle_epi32(v1, 0xe7); // 0xx0
 	v0 = _mm_slli_epi64(v1, 32);  // [0]
 	v0 = _mm_clmulepi64_si128(v0, vfold8, 0x00);
@@ -271,22 +326,31 @@ uint32_t crc32_clmul(const uint8_t *data, size_t length, uint32_t crc) {
 	return ~_mm_extract_epi32(v0, 2);
 }
 
-uint64_t crc64_clmul(const uint8_t *data, size_t length, uint64_t crc) {
+uint32_t crc32_clmul(const uint8_t *data, size_t length, uint32_t crc) {
+	// uint32_t p = 0xedb88320;
+	uint64_t i3 = 0x0ccaa009e; // calc_hi(p, p, 64) << 1
+	uint64_t i4 = 0x1751997d0; // calc_hi(p, p, 128) << 1
+	uint64_t i5 = 0x1c6e41596; // calc_hi(p, p, 448) << 1
+	uint64_t i6 = 0x154442bd4; // calc_hi(p, p, 512) << 1
+
+	__m128i vfold16 = _mm_set_epi64x(i3, i4);
+	__m128i vfold64 = _mm_set_epi64x(i5, i6);
+
+	CRC_SIMD_BODY(_mm_cvtsi32_si128(~crc))
+
+	return crc32_clmul_reduce(v0, v1);
+}
+
+/* reduces the last 16 bytes (low half of v0, v1) to the CRC */
+static inline uint64_t crc64_clmul_reduce(__m128i v0, __m128i v1) {
 	// uint64_t p = 0xc96c5795d7870f42;
 	uint64_t i0 = 0x92d8af2baf0e1e84; // p << 1
 	uint64_t i1 = 0x9c3e466c172963d5; // calc_lo(p, 1, 64)
 	uint64_t i2 = 0xdabe95afc7875f40; // calc_hi(p, 1, 64)
-	uint64_t i3 = 0xe05dd497ca393ae4; // calc_hi(p, i2, 64)
 	__m128i vfold8 = _mm_set_epi64x(i0, i1);
-	__m128i vfold16 = _mm_set_epi64x(i2, i3);
+	__m128i v2;
 
-#ifdef __i386__
-	CRC_SIMD_BODY(_mm_set_epi64x(0, ~crc))
-#else
-	CRC_SIMD_BODY(_mm_cvtsi64_si128(~crc))
-#endif
-
-	v1 = _mm_xor_si128(_mm_clmulepi64_si128(v0, vfold16, 0x10), v1);
+	v1 = _mm_xor_si128(_mm_clmulepi64_si128(v0, _mm_set_epi64x(0, i2), 0x00), v1);
 	v0 = _mm_clmulepi64_si128(v1, vfold8, 0x00);
 	v2 = _mm_clmulepi64_si128(v0, vfold8, 0x10);
 	v0 = _mm_xor_si128(_mm_xor_si128(v1, _mm_slli_si128(v0, 8)), v2);
@@ -299,7 +363,29 @@ uint64_t crc64_clmul(const uint8_t *data, size_t length, uint64_t crc) {
 #endif
 }
 
+uint64_t crc64_clmul(const uint8_t *data, size_t length, uint64_t crc) {
+	// uint64_t p = 0xc96c5795d7870f42;
+	uint64_t i2 = 0xdabe95afc7875f40; // calc_hi(p, 1, 64)
+	uint64_t i3 = 0xe05dd497ca393ae4; // calc_hi(p, i2, 64)
+	uint64_t i4 = 0x081f6054a7842df4; // calc_hi(p, 1, 448)
+	uint64_t i5 = 0x6ae3efbb9dd441f3; // calc_hi(p, 1, 512)
+	__m128i vfold16 = _mm_set_epi64x(i2, i3);
+	__m128i vfold64 = _mm_set_epi64x(i4, i5);
+
+#ifdef __i386__
+	CRC_SIMD_BODY(_mm_set_epi64x(0, ~crc))
+#else
+	CRC_SIMD_BODY(_mm_cvtsi64_si128(~crc))
+#endif
+
+	return crc64_clmul_reduce(v0, v1);
+}
+
+#undef CRC_SIMD_LOOP4
 #undef CRC_SIMD_LOOP
+#undef CRC_SIMD_ASM
+#undef CRC_SIMD_MOV
 #undef CRC_SIMD_BODY
+#undef FOLD4
 #undef FOLD
 #endif
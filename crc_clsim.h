@@ -256,9 +256,211 @@ uint64_t crc64_clsim(const uint8_t *s, size_t n, uint64_t c) {
 		c = (c ^ *a++) << (64 - n);
 		FOLD1(c) c ^= x ^ v;
 	}
-#undef FOLD1
 #undef FOLD2
 #undef FOLD3
 	return ~c;
 }
 
+/* one 8-byte word on the raw state, for crc_interleave.h */
+static inline uint64_t crc64_clsim_step(uint64_t c, uint64_t w) {
+	uint64_t x;
+#ifndef CLMUL_SIM
+	uint64_t i0 = 0x92d8af2baf0e1e84; // p << 1
+	uint64_t i1 = 0x9c3e466c172963d5; // calc_lo(p, 1, 64)
+#else
+	uint64_t t, y, u;
+#endif
+	c ^= w; FOLD1(c)
+	return c ^ x;
+#undef FOLD1
+}
+
+/*
+ * Wider stride: 32 or 64 bytes per iteration in 4 or 8 independent
+ * 64-bit accumulators (2 or 4 lanes of 16 bytes), each folded by the
+ * stride. The accumulators are then reduced with crc32_clsim.
+ */
+
+#ifndef CLMUL_SIM
+#define K256(x, r, o) r o clmul64(x, 0xf1da05aa);
+#define K224(x, r, o) r o clmul64(x, 0x01b5fd1d);
+#define K512(x, r, o) r o clmul64(x, 0x8f352d95);
+#define K480(x, r, o) r o clmul64(x, 0xcad38e8f);
+#else
+/* clsim_gen -p 0xedb88320 -d n */
+#define K256(x, r, o) \
+	/* shift = 8, xor = 7(+1) */ \
+	t0 = x^x<<2; t1 = t0^t0<<12; t2 = x^t0<<5; \
+	r o t0<<1^t1<<5^t1<<8^t2<<23^t2<<24;
+#define K224(x, r, o) \
+	/* shift = 7, xor = 7(+1) */ \
+	t0 = x^x<<8; t1 = t0^t0<<13; t2 = t1^x<<18; \
+	r o t2^t2<<2^t1<<3^t0<<4^x<<14;
+#define K512(x, r, o) \
+	/* shift = 7, xor = 7(+1) */ \
+	t0 = x^x<<2; t1 = x^t0<<4; t2 = t0^t1<<4; \
+	r o t2^t1<<7^t2<<16^t1<<21^x<<31;
+#define K480(x, r, o) \
+	/* shift = 7, xor = 7(+1) */ \
+	t0 = x^x<<1; t1 = t0^t0<<8; t2 = t1^t1<<5; \
+	r o t1^t2<<2^t2<<17^t1<<18^t0<<19;
+#endif
+
+#define FOLDW(f, a, K0, K1) \
+	g = (uint32_t)f; K0(g, h, =) \
+	g = f >> 32; K1(g, h, ^=) \
+	f = h ^ a;
+
+uint32_t crc32_clsim_2x(const uint8_t *s, size_t n, uint32_t c) {
+	uintptr_t r = -(uintptr_t)s & 7;
+	uint64_t f[4], g, h; const uint64_t *a; int i;
+#ifdef CLMUL_SIM
+	uint64_t t0, t1, t2;
+#endif
+	if (n < r + 64) return crc32_clsim(s, n, c);
+	c = crc32_clsim(s, r, c);
+	a = (const uint64_t*)(s + r); n -= r;
+	for (i = 0; i < 4; i++) f[i] = a[i];
+	f[0] ^= (uint32_t)~c;
+	for (a += 4, n -= 32; n >= 32; a += 4, n -= 32)
+		for (i = 0; i < 4; i++) {
+			FOLDW(f[i], a[i], K256, K224)
+		}
+	c = crc32_clsim((const uint8_t*)f, 32, ~(uint32_t)0);
+	return crc32_clsim((const uint8_t*)a, n, c);
+}
+
+uint32_t crc32_clsim_4x(const uint8_t *s, size_t n, uint32_t c) {
+	uintptr_t r = -(uintptr_t)s & 7;
+	uint64_t f[8], g, h; const uint64_t *a; int i;
+#ifdef CLMUL_SIM
+	uint64_t t0, t1, t2;
+#endif
+	if (n < r + 128) return crc32_clsim(s, n, c);
+	c = crc32_clsim(s, r, c);
+	a = (const uint64_t*)(s + r); n -= r;
+	for (i = 0; i < 8; i++) f[i] = a[i];
+	f[0] ^= (uint32_t)~c;
+	for (a += 8, n -= 64; n >= 64; a += 8, n -= 64)
+		for (i = 0; i < 8; i++) {
+			FOLDW(f[i], a[i], K512, K480)
+		}
+	c = crc32_clsim((const uint8_t*)f, 64, ~(uint32_t)0);
+	return crc32_clsim((const uint8_t*)a, n, c);
+}
+
+#undef FOLDW
+#undef K256
+#undef K224
+#undef K512
+#undef K480
+
+#ifndef CLMUL_SIM
+#define K256_LO(x, r, o) r o clmul64(x, 0x60095b008a9efa44);
+#define K256_HI(x, r, o) r o clmul64_hi(x, 0x60095b008a9efa44);
+#define K192_LO(x, r, o) r o clmul64(x, 0x3be653a30fe1af51);
+#define K192_HI(x, r, o) r o clmul64_hi(x, 0x3be653a30fe1af51);
+#define K512_LO(x, r, o) r o clmul64(x, 0x6ae3efbb9dd441f3);
+#define K512_HI(x, r, o) r o clmul64_hi(x, 0x6ae3efbb9dd441f3);
+#define K448_LO(x, r, o) r o clmul64(x, 0x081f6054a7842df4);
+#define K448_HI(x, r, o) r o clmul64_hi(x, 0x081f6054a7842df4);
+#else
+/* clsim_gen -p 0xc96c5795d7870f42 -d n */
+#define K256_LO(x, r, o) \
+	/* shift = 12, xor = 12(+1) */ \
+	t5 = x<<2; t0 = x^t5; t1 = t0^x<<39; \
+	t2 = x^x<<34; t3 = t1^t0<<32; t4 = t0^t2<<14; \
+	r o t5^t2<<6^t3<<9^t3<<12^t4<<13^t4<<17^t0<<18^t1<<23;
+#define K256_HI(x, r, o) \
+	/* shift = 9, xor = 10(+1) */ \
+	t0 = x^x>>33; t1 = t0^x>>34; t6 = t1>>21; \
+	t7 = t1>>13; t2 = t1^t6; t3 = t2^t1>>42; \
+	t4 = t3^t7; t5 = t4^t2>>15; \
+	r o t3>>2^t5>>3^t7^t5>>20^t6;
+#define K192_LO(x, r, o) \
+	/* shift = 12, xor = 12(+1) */ \
+	t0 = x^x<<4; t1 = t0^x<<43; t2 = t1^t1<<12; \
+	t3 = t1^t1<<49; t4 = t2^t3<<13; t5 = t3^t4<<3; \
+	t6 = t4^t3<<21; \
+	r o t2^t5<<6^t5<<8^t6<<28^t4<<33^t6<<39;
+#define K192_HI(x, r, o) \
+	/* shift = 12, xor = 12(+1) */ \
+	t0 = x^x>>1; t1 = t0^x>>19; t6 = t1>>50; \
+	t2 = t1^t1>>3; t3 = t2^t6; t4 = t1^t6; \
+	t5 = t4^t2>>9; \
+	r o t3>>3^t3>>5^t5>>10^t4>>14^t4>>18^t2>>29^t5>>30;
+#define K512_LO(x, r, o) \
+	/* shift = 12, xor = 12(+1) */ \
+	t0 = x^x<<8; t1 = t0^x<<24; t2 = t1^t1<<5; \
+	t3 = t2^t1<<46; t4 = t3^t3<<36; t5 = t4^t1<<8; \
+	r o t2^t3<<1^t2<<4^t5<<7^t5<<13^t2<<17^t3<<27;
+#define K512_HI(x, r, o) \
+	/* shift = 13, xor = 12(+1) */ \
+	t0 = x^x>>4; t1 = t0^t0>>13; t2 = x^t0>>1; \
+	t3 = t1^t1>>6; t4 = t2^t3>>3; \
+	r o t4>>2^x>>10^t4>>16^t3>>27^x>>41^t0>>56^x>>57^t2>>58;
+#define K448_LO(x, r, o) \
+	/* shift = 11, xor = 11(+1) */ \
+	t0 = x^x<<6; t1 = t0^x<<45; t7 = t1<<48; \
+	t2 = t1^t1<<2; t3 = t1^t7; t4 = t2^t2<<21; \
+	t5 = t4^t1<<10; t6 = t3^t5<<18; \
+	r o t4<<2^t2<<5^t6<<6^t6<<12^t7;
+#define K448_HI(x, r, o) \
+	/* shift = 12, xor = 11(+1) */ \
+	t0 = x^x>>4; t1 = t0^t0>>18; t2 = t0^t1>>9; \
+	t3 = t2^t1>>10; \
+	r o t3>>5^t0>>9^t0>>12^t3>>26^t3>>28^t0>>42^t0>>51^t0>>62;
+#endif
+
+#define FOLDW(c, x, a0, a1, K0, K1) \
+	K0##_LO(c, v, =) K1##_LO(x, v, ^=) \
+	K0##_HI(c, w, =) K1##_HI(x, w, ^=) \
+	c = v ^ a0; x = w ^ a1;
+
+uint64_t crc64_clsim_2x(const uint8_t *s, size_t n, uint64_t c) {
+	uintptr_t r = -(uintptr_t)s & 7;
+	uint64_t f[4], v, w; const uint64_t *a; int i;
+#ifdef CLMUL_SIM
+	uint64_t t0, t1, t2, t3, t4, t5, t6, t7;
+#endif
+	if (n < r + 64) return crc64_clsim(s, n, c);
+	c = crc64_clsim(s, r, c);
+	a = (const uint64_t*)(s + r); n -= r;
+	for (i = 0; i < 4; i++) f[i] = a[i];
+	f[0] ^= ~c;
+	for (a += 4, n -= 32; n >= 32; a += 4, n -= 32)
+		for (i = 0; i < 4; i += 2) {
+			FOLDW(f[i], f[i + 1], a[i], a[i + 1], K256, K192)
+		}
+	c = crc64_clsim((const uint8_t*)f, 32, ~(uint64_t)0);
+	return crc64_clsim((const uint8_t*)a, n, c);
+}
+
+uint64_t crc64_clsim_4x(const uint8_t *s, size_t n, uint64_t c) {
+	uintptr_t r = -(uintptr_t)s & 7;
+	uint64_t f[8], v, w; const uint64_t *a; int i;
+#ifdef CLMUL_SIM
+	uint64_t t0, t1, t2, t3, t4, t5, t6, t7;
+#endif
+	if (n < r + 128) return crc64_clsim(s, n, c);
+	c = crc64_clsim(s, r, c);
+	a = (const uint64_t*)(s + r); n -= r;
+	for (i = 0; i < 8; i++) f[i] = a[i];
+	f[0] ^= ~c;
+	for (a += 8, n -= 64; n >= 64; a += 8, n -= 64)
+		for (i = 0; i < 8; i += 2) {
+			FOLDW(f[i], f[i + 1], a[i], a[i + 1], K512, K448)
+		}
+	c = crc64_clsim((const uint8_t*)f, 64, ~(uint64_t)0);
+	return crc64_clsim((const uint8_t*)a, n, c);
+}
+
+#undef FOLDW
+#undef K256_LO
+#undef K256_HI
+#undef K192_LO
+#undef K192_HI
+#undef K512_LO
+#undef K512_HI
+#undef K448_LO
+#undef K448_HI
@@ -0,0 +1,152 @@
+/*
+ * CRC32 (PKZIP) and CRC64 (XZ) using CLMUL simulation on vectors, for
+ * CPUs with SIMD but without a usable CLMUL: 128-byte stride in 16
+ * independent 64-bit accumulators, 2 per vector with SSE2 or NEON, 4
+ * with AVX2. The shift/xor sequences are the same as in crc_clsim.h,
+ * written with GCC vector extensions.
+ *
+ * Requires "crc_clsim.h" for the head, the tail and the final reduction.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#define CLSIMV_LANES 4
+#else
+#define CLSIMV_LANES 2
+#endif
+
+typedef uint64_t clsimv_t __attribute__((vector_size(CLSIMV_LANES * 8)));
+
+/* vectors per 128 bytes */
+#define CLSIMV_N (128 / (int)sizeof(clsimv_t))
+
+#define CLSIMV_LOAD(v, p) memcpy(&v, p, sizeof(v));
+
+/* clsim_gen -p 0xedb88320 -d n */
+#define K1024(x, r, o) \
+	/* shift = 7, xor = 7(+1) */ \
+	t0 = x^x<<1; t1 = t0^t0<<4; t2 = t1^t1<<8; \
+	r o t2^t0<<9^t1<<14^t2<<16^t0<<22;
+#define K992(x, r, o) \
+	/* shift = 7, xor = 7(+1) */ \
+	t0 = x^x<<2; t1 = t0^x<<18; t2 = t1^t0<<15; \
+	r o t2^x<<4^t0<<7^t2<<11^t1<<12;
+
+uint32_t crc32_clsimv(const uint8_t *s, size_t n, uint32_t c) {
+	uintptr_t r = -(uintptr_t)s & 7;
+	clsimv_t f[CLSIMV_N], a, g, h, t0, t1, t2;
+	uint64_t buf[16];
+	int i;
+
+	if (n < r + 256) return crc32_clsim(s, n, c);
+	c = crc32_clsim(s, r, c);
+	s += r; n -= r;
+	for (i = 0; i < CLSIMV_N; i++) CLSIMV_LOAD(f[i], s + i * sizeof(a))
+	f[0][0] ^= (uint32_t)~c;
+	for (s += 128, n -= 128; n >= 128; s += 128, n -= 128)
+		for (i = 0; i < CLSIMV_N; i++) {
+			CLSIMV_LOAD(a, s + i * sizeof(a))
+			g = f[i] & 0xffffffff; K1024(g, h, =)
+			g = f[i] >> 32; K992(g, h, ^=)
+			f[i] = h ^ a;
+		}
+	memcpy(buf, f, sizeof(buf));
+	c = crc32_clsim((const uint8_t*)buf, 128, ~(uint32_t)0);
+	return crc32_clsim(s, n, c);
+}
+
+#undef K1024
+#undef K992
+
+/* clsim_gen -p 0xc96c5795d7870f42 -d n */
+#define K1024_LO(x, r, o) \
+	/* shift = 11, xor = 10(+1) */ \
+	t0 = x^x<<22; t1 = t0^t0<<6; t2 = t1^t0<<51; \
+	t3 = t2^t2<<24; t4 = t2^t0<<3; \
+	r o t3<<12^t4<<19^x<<23^t4<<24^t3<<26^t0<<35;
+#define K1024_HI(x, r, o) \
+	/* shift = 12, xor = 11(+1) */ \
+	t0 = x^x>>22; t1 = t0^x>>57; t2 = t1^t1>>2; \
+	t3 = t2^t1>>30; t4 = t3^t2>>4; \
+	r o t1>>1^t4>>6^t1>>7^t4>>14^t3>>15^t3>>22^t1>>41;
+#define K960_LO(x, r, o) \
+	/* shift = 12, xor = 12(+1) */ \
+	t0 = x^x<<4; t1 = t0^x<<26; t2 = t1^t1<<6; \
+	t3 = t2^t1<<52; t6 = t3<<20; t4 = t3^t1<<15; \
+	t5 = t3^t6; \
+	r o t4<<6^t5<<8^t5<<9^t6^t3<<31^t1<<39^t4<<41;
+#define K960_HI(x, r, o) \
+	/* shift = 13, xor = 12(+1) */ \
+	t0 = x^x>>27; t1 = t0^t0>>1; t2 = t0^t1>>2; \
+	t3 = t1^t0>>48; t4 = t2^t1>>33; \
+	r o t3>>1^t4>>4^t3>>8^t4>>10^t1>>18^t2>>21^t1>>27^t0>>58;
+
+/*
+ * Each 16-byte lane is a pair (low, high word) folded with two constants,
+ * so the pairs are kept split: the low words in e[], the high ones in o[].
+ */
+#ifdef __clang__
+#define CLSIMV_SHUFFLE(a, b, ...) __builtin_shufflevector(a, b, __VA_ARGS__)
+#else
+#define CLSIMV_SHUFFLE(a, b, ...) __builtin_shuffle(a, b, (clsimv_t){ __VA_ARGS__ })
+#endif
+
+#if CLSIMV_LANES == 4
+#define CLSIMV_EVEN(a, b) CLSIMV_SHUFFLE(a, b, 0, 2, 4, 6)
+#define CLSIMV_ODD(a, b) CLSIMV_SHUFFLE(a, b, 1, 3, 5, 7)
+#define CLSIMV_ZIP_LO(a, b) CLSIMV_SHUFFLE(a, b, 0, 4, 1, 5)
+#define CLSIMV_ZIP_HI(a, b) CLSIMV_SHUFFLE(a, b, 2, 6, 3, 7)
+#else
+#define CLSIMV_EVEN(a, b) CLSIMV_SHUFFLE(a, b, 0, 2)
+#define CLSIMV_ODD(a, b) CLSIMV_SHUFFLE(a, b, 1, 3)
+#define CLSIMV_ZIP_LO(a, b) CLSIMV_SHUFFLE(a, b, 0, 2)
+#define CLSIMV_ZIP_HI(a, b) CLSIMV_SHUFFLE(a, b, 1, 3)
+#endif
+
+uint64_t crc64_clsimv(const uint8_t *s, size_t n, uint64_t c) {
+	uintptr_t r = -(uintptr_t)s & 7;
+	clsimv_t e[CLSIMV_N / 2], o[CLSIMV_N / 2], a, b, v, w;
+	clsimv_t t0, t1, t2, t3, t4, t5, t6;
+	uint64_t buf[16];
+	int i;
+
+	if (n < r + 256) return crc64_clsim(s, n, c);
+	c = crc64_clsim(s, r, c);
+	s += r; n -= r;
+	for (i = 0; i < CLSIMV_N / 2; i++) {
+		CLSIMV_LOAD(a, s + 2 * i * sizeof(a))
+		CLSIMV_LOAD(b, s + (2 * i + 1) * sizeof(a))
+		e[i] = CLSIMV_EVEN(a, b); o[i] = CLSIMV_ODD(a, b);
+	}
+	e[0][0] ^= ~c;
+	for (s += 128, n -= 128; n >= 128; s += 128, n -= 128)
+		for (i = 0; i < CLSIMV_N / 2; i++) {
+			CLSIMV_LOAD(a, s + 2 * i * sizeof(a))
+			CLSIMV_LOAD(b, s + (2 * i + 1) * sizeof(a))
+			K1024_LO(e[i], v, =) K960_LO(o[i], v, ^=)
+			K1024_HI(e[i], w, =) K960_HI(o[i], w, ^=)
+			e[i] = v ^ CLSIMV_EVEN(a, b);
+			o[i] = w ^ CLSIMV_ODD(a, b);
+		}
+	for (i = 0; i < CLSIMV_N / 2; i++) {
+		a = CLSIMV_ZIP_LO(e[i], o[i]); b = CLSIMV_ZIP_HI(e[i], o[i]);
+		memcpy(buf + 2 * i * CLSIMV_LANES, &a, sizeof(a));
+		memcpy(buf + (2 * i + 1) * CLSIMV_LANES, &b, sizeof(b));
+	}
+	c = crc64_clsim((const uint8_t*)buf, 128, ~(uint64_t)0);
+	return crc64_clsim(s, n, c);
+}
+
+#undef K1024_LO
+#undef K1024_HI
+#undef K960_LO
+#undef K960_HI
+#undef CLSIMV_SHUFFLE
+#undef CLSIMV_EVEN
+#undef CLSIMV_ODD
+#undef CLSIMV_ZIP_LO
+#undef CLSIMV_ZIP_HI
+#undef CLSIMV_LOAD
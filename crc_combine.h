@@ -0,0 +1,198 @@
+/*
+ * Combining CRCs: crc(A || B) from crc(A), crc(B) and the length of B,
+ * for CRC32 (PKZIP) and CRC64 (XZ).
+ *
+ * The shift of crc(A) over len(B) bytes is a multiplication by
+ * x^(8 * len) mod P, computed in O(log len) from a table of
+ * x^(8 * 2^k) mod P. The same method as in zlib, but with the
+ * multiplication done by CLMUL where available.
+ *
+ * crc32/64_multmodp and _xnmodp do the same bitwise for any polynomial,
+ * for crc_interleave.h, crc_hybrid.h and crc_parallel.h.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__SSE4_1__) && defined(__PCLMUL__)
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#define CRC_COMBINE_CLMUL 1
+static inline uint64_t crc_combine_clmul(uint64_t a, uint64_t b, uint64_t *hi) {
+	uint64_t r[2];
+	_mm_storeu_si128((__m128i*)r, _mm_clmulepi64_si128(
+			_mm_set_epi64x(0, a), _mm_set_epi64x(0, b), 0));
+	*hi = r[1];
+	return r[0];
+}
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#include <arm_neon.h>
+#define CRC_COMBINE_CLMUL 1
+static inline uint64_t crc_combine_clmul(uint64_t a, uint64_t b, uint64_t *hi) {
+	poly128_t r = vmull_p64(a, b);
+	*hi = (uint64_t)(r >> 64);
+	return (uint64_t)r;
+}
+#else
+#define CRC_COMBINE_CLMUL 0
+#endif
+
+/* a * b mod P, the highest bit is x^0 */
+static inline uint32_t crc32_multmodp(uint32_t p, uint32_t a, uint32_t b) {
+	uint32_t x = 0;
+	do {
+		x ^= b & (int32_t)a >> 31;
+		b = b >> 1 ^ ((0 - (b & 1)) & p);
+	} while ((a <<= 1));
+	return x;
+}
+
+static inline uint64_t crc64_multmodp(uint64_t p, uint64_t a, uint64_t b) {
+	uint64_t x = 0;
+	do {
+		x ^= b & (int64_t)a >> 63;
+		b = b >> 1 ^ ((0 - (b & 1)) & p);
+	} while ((a <<= 1));
+	return x;
+}
+
+/* x^n mod P */
+static uint32_t crc32_xnmodp(uint32_t p, uint64_t n) {
+	uint32_t a = 1u << 31, b = 1u << 30;
+	for (; n; n >>= 1, b = crc32_multmodp(p, b, b))
+		if (n & 1) a = crc32_multmodp(p, a, b);
+	return a;
+}
+
+static uint64_t crc64_xnmodp(uint64_t p, uint64_t n) {
+	uint64_t a = (uint64_t)1 << 63, b = (uint64_t)1 << 62;
+	for (; n; n >>= 1, b = crc64_multmodp(p, b, b))
+		if (n & 1) a = crc64_multmodp(p, a, b);
+	return a;
+}
+
+/* a * b mod P, bit 31 is x^0 */
+static uint32_t crc32_combine_mul(uint32_t a, uint32_t b) {
+#if CRC_COMBINE_CLMUL
+	// uint32_t p = 0xedb88320;
+	uint64_t i0 = 0xdb710640; // p << 1
+	uint64_t i1 = 0xf7011641; // calc_lo(p, 1, 32)
+	uint64_t x, hi, lo = crc_combine_clmul(a, b, &hi);
+	/* the high half is x^0..x^31, the low one is reduced as a crc */
+	x = (uint32_t)crc_combine_clmul((uint32_t)(lo << 1), i1, &hi);
+	return (uint32_t)(lo >> 31) ^ (uint32_t)x ^
+			(uint32_t)(crc_combine_clmul(x, i0, &hi) >> 32);
+#else
+	return crc32_multmodp(0xedb88320, a, b);
+#endif
+}
+
+/* a * b mod P, bit 63 is x^0 */
+static uint64_t crc64_combine_mul(uint64_t a, uint64_t b) {
+#if CRC_COMBINE_CLMUL
+	// uint64_t p = 0xc96c5795d7870f42;
+	uint64_t i0 = 0x92d8af2baf0e1e84; // p << 1
+	uint64_t i1 = 0x9c3e466c172963d5; // calc_lo(p, 1, 64)
+	uint64_t x, h, hi, lo = crc_combine_clmul(a, b, &hi);
+	hi = hi << 1 | lo >> 63;
+	x = crc_combine_clmul(lo << 1, i1, &h);
+	crc_combine_clmul(x, i0, &h);
+	return hi ^ x ^ h;
+#else
+	return crc64_multmodp(0xc96c5795d7870f42, a, b);
+#endif
+}
+
+/* x^(8 * 2^k) mod P, each the square of the one before from x^8 */
+static const uint32_t crc32_x8n_table[64] = {
+	0x00800000, 0x00008000, 0xedb88320, 0xb1e6b092, 0xa06a2517, 0xed627dae, 0x88d14467, 0xd7bbfe6a,
+	0xec447f11, 0x8e7ea170, 0x6427800e, 0x4d47bae0, 0x09fe548f, 0x83852d0f, 0x30362f1a, 0x7b5a9cc3,
+	0x31fec169, 0x9fec022a, 0x6c8dedc4, 0x15d6874d, 0x5fde7a4e, 0xbad90e37, 0x2e4e5eef, 0x4eaba214,
+	0xa8a472c0, 0x429a969e, 0x148d302a, 0xc40ba6d0, 0xc4e22c3c, 0x40000000, 0x20000000, 0x08000000,
+	0x00800000, 0x00008000, 0xedb88320, 0xb1e6b092, 0xa06a2517, 0xed627dae, 0x88d14467, 0xd7bbfe6a,
+	0xec447f11, 0x8e7ea170, 0x6427800e, 0x4d47bae0, 0x09fe548f, 0x83852d0f, 0x30362f1a, 0x7b5a9cc3,
+	0x31fec169, 0x9fec022a, 0x6c8dedc4, 0x15d6874d, 0x5fde7a4e, 0xbad90e37, 0x2e4e5eef, 0x4eaba214,
+	0xa8a472c0, 0x429a969e, 0x148d302a, 0xc40ba6d0, 0xc4e22c3c, 0x40000000, 0x20000000, 0x08000000
+};
+
+static const uint64_t crc64_x8n_table[64] = {
+	0x0080000000000000, 0x0000800000000000, 0x0000000080000000, 0xc96c5795d7870f42,
+	0x6d5f4ad7e3c3afa0, 0xd49f7e445077d8ea, 0x040fb02a53c216fa, 0x6bec35957b9ef3a0,
+	0xb0e3bb0658964afe, 0x218578c7a2dff638, 0x6dbb920f24dd5cf2, 0x7a140cfcdb4d5eb5,
+	0x41b3705ecbc4057b, 0xd46ab656accac1ea, 0x329beda6fc34fb73, 0x51a4fcd4350b9797,
+	0x314fa85637efae9d, 0xacf27e9a1518d512, 0xffe2a3388a4d8ce7, 0x48b9697e60cc2e4e,
+	0xada73cb78dd62460, 0x3ea5454d8ce5c1bb, 0x5e84e3a6c70feaf1, 0x90fd49b66cbd81d1,
+	0xe2943e0c1db254e8, 0xecfa6adeca8834a1, 0xf513e212593ee321, 0xf36ae57331040916,
+	0x63fbd333b87b6717, 0xbd60f8e152f50b8b, 0xa5ce4a8299c1567d, 0x0bd445f0cbdb55ee,
+	0xfdd6824e20134285, 0xcead8b6ebda2227a, 0xe44b17e4f5d4fb5c, 0x9b29c81ad01ca7c5,
+	0x1b4366e40fea4055, 0x27bca1551aae167b, 0xaa57bcd1b39a5690, 0xd7fce83fa1234db9,
+	0xcce4986efea3ff8e, 0x3602a4d9e65341f1, 0x722b1da2df516145, 0xecfc3ddd3a08da83,
+	0x0fb96dcca83507e6, 0x125f2fe78d70f080, 0x842f50b7651aa516, 0x09bc34188cd9836f,
+	0xf43666c84196d909, 0xb56feb30c0df6ccb, 0xaa66e04ce7f30958, 0xb7b1187e9af29547,
+	0x113255f8476495de, 0x8fb19f783095d77e, 0xaec4aacc7c82b133, 0xf64e6d09218428cf,
+	0x036a72ea5ac258a0, 0x5235ef12eb7aaa6a, 0x2fed7b1685657853, 0x8ef8951d46606fb5,
+	0x9d58c1090f034d14, 0x36f6c59a9fdaa97b, 0xbe2d517d98682592, 0x7bcd738fef5729f1
+};
+
+/* x^(8 * len) mod P, the operator for crc32_combine_op */
+uint32_t crc32_combine_gen(uint64_t len) {
+	uint32_t a = 1u << 31; int k;
+	for (k = 0; len; k++, len >>= 1)
+		if (len & 1) a = crc32_combine_mul(crc32_x8n_table[k], a);
+	return a;
+}
+
+uint64_t crc64_combine_gen(uint64_t len) {
+	uint64_t a = (uint64_t)1 << 63; int k;
+	for (k = 0; len; k++, len >>= 1)
+		if (len & 1) a = crc64_combine_mul(crc64_x8n_table[k], a);
+	return a;
+}
+
+/* x^(8 * n) mod P, from the tables for PKZIP and XZ */
+static uint32_t crc32_x8nmodp(uint32_t p, uint64_t n) {
+	return p == 0xedb88320 ? crc32_combine_gen(n) : crc32_xnmodp(p, 8 * n);
+}
+
+static uint64_t crc64_x8nmodp(uint64_t p, uint64_t n) {
+	return p == 0xc96c5795d7870f42 ? crc64_combine_gen(n) : crc64_xnmodp(p, 8 * n);
+}
+
+/* the bit order swapped, for the non-reflected CRCs of the same P */
+static inline uint32_t crc32_reflect(uint32_t a) {
+	uint32_t r = 0; int i;
+	for (i = 0; i < 32; i++, a >>= 1) r = r << 1 | (a & 1);
+	return r;
+}
+
+static inline uint64_t crc64_reflect(uint64_t a) {
+	uint64_t r = 0; int i;
+	for (i = 0; i < 64; i++, a >>= 1) r = r << 1 | (a & 1);
+	return r;
+}
+
+uint32_t crc32_combine_op(uint32_t crc1, uint32_t crc2, uint32_t op) {
+	return crc32_combine_mul(op, crc1) ^ crc2;
+}
+
+uint64_t crc64_combine_op(uint64_t crc1, uint64_t crc2, uint64_t op) {
+	return crc64_combine_mul(op, crc1) ^ crc2;
+}
+
+/* crc(A || B) = crc(A) * x^(8 * len(B)) mod P ^ crc(B) */
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t len2) {
+	return crc32_combine_op(crc1, crc2, crc32_combine_gen(len2));
+}
+
+uint64_t crc64_combine(uint64_t crc1, uint64_t crc2, uint64_t len2) {
+	return crc64_combine_op(crc1, crc2, crc64_combine_gen(len2));
+}
+
+/* the raw state shifted over len zero bytes (no pre/post inversion) */
+uint32_t crc32_shift(uint32_t crc, uint64_t len) {
+	return crc32_combine_mul(crc32_combine_gen(len), crc);
+}
+
+uint64_t crc64_shift(uint64_t crc, uint64_t len) {
+	return crc64_combine_mul(crc64_combine_gen(len), crc);
+}
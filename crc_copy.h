@@ -0,0 +1,223 @@
+/*
+ * Copy and checksum in one pass: crc32/64_<kernel>_copy(dst, src, n, crc)
+ * copies n bytes and returns their CRC, so the source is only read once.
+ * crc32_copy and crc64_copy are the CLMUL ones, else slice by 8.
+ *
+ * _clmul_copy (x86) stores each 16-byte block it folds, aligned to dst.
+ * _slice8_copy stores each 8-byte word it looks up. _clsim_copy copies
+ * CRC_COPY_CHUNK bytes at a time and checksums them while they are in L1.
+ *
+ * From crc_copy_nt bytes up, the stores are non-temporal (SSE2), so a
+ * large destination doesn't evict the working set; 0 for always.
+ *
+ * Requires "crc_slice16.h", "crc_clsim.h" and with HAVE_CLMUL "crc_clmul.h".
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define CRC_COPY_CHUNK 4096
+
+#ifndef CRC_COPY_NT
+#define CRC_COPY_NT ((size_t)8 << 20)
+#endif
+
+static size_t crc_copy_nt = CRC_COPY_NT;
+
+#ifdef __SSE2__
+#define CRC_COPY_SFENCE(nt) if (nt) _mm_sfence();
+#else
+#define CRC_COPY_SFENCE(nt)
+#endif
+
+/* memcpy, or with non-temporal stores */
+static void crc_copy_mem(uint8_t *d, const uint8_t *s, size_t n, int nt) {
+#ifdef __SSE2__
+	if (nt) {
+		for (; n && (uintptr_t)d & 15; n--) *d++ = *s++;
+		for (; n >= 64; n -= 64, d += 64, s += 64) {
+			_mm_stream_si128((__m128i*)d, _mm_loadu_si128((const __m128i*)s));
+			_mm_stream_si128((__m128i*)d + 1, _mm_loadu_si128((const __m128i*)s + 1));
+			_mm_stream_si128((__m128i*)d + 2, _mm_loadu_si128((const __m128i*)s + 2));
+			_mm_stream_si128((__m128i*)d + 3, _mm_loadu_si128((const __m128i*)s + 3));
+		}
+	}
+#else
+	(void)nt;
+#endif
+	memcpy(d, s, n);
+}
+
+#define CRC_COPY_CHUNKED(T, kernel) \
+	int nt = n >= crc_copy_nt; \
+	while (n) { \
+		size_t k = n < CRC_COPY_CHUNK ? n : CRC_COPY_CHUNK; \
+		crc_copy_mem(dst, src, k, nt); \
+		crc = kernel(src, k, crc); \
+		dst += k; src += k; n -= k; \
+	} \
+	CRC_COPY_SFENCE(nt) \
+	return crc;
+
+uint32_t crc32_clsim_copy(uint8_t *dst, const uint8_t *src, size_t n, uint32_t crc) {
+	CRC_COPY_CHUNKED(uint32_t, crc32_clsim)
+}
+
+uint64_t crc64_clsim_copy(uint8_t *dst, const uint8_t *src, size_t n, uint64_t crc) {
+	CRC_COPY_CHUNKED(uint64_t, crc64_clsim)
+}
+
+/* 8 bytes of x, as in crc_slice16.h */
+#define CRC_COPY_SLICE8(T, x) ( \
+	T[7][x & 0xff] ^ T[6][x >> 8 & 0xff] ^ \
+	T[5][x >> 16 & 0xff] ^ T[4][x >> 24 & 0xff] ^ \
+	T[3][x >> 32 & 0xff] ^ T[2][x >> 40 & 0xff] ^ \
+	T[1][x >> 48 & 0xff] ^ T[0][x >> 56])
+
+#if defined(__SSE2__) && defined(__x86_64__)
+#define CRC_COPY_STORE8(d, w) \
+	if (nt) _mm_stream_si64((long long*)(d), (long long)(w)); \
+	else memcpy(d, &w, 8);
+#else
+#define CRC_COPY_STORE8(d, w) memcpy(d, &w, 8);
+#endif
+
+#define CRC_COPY_SLICE(T) \
+	int nt = n >= crc_copy_nt; \
+	crc = ~crc; \
+	for (; n && (uintptr_t)src & 7; n--) { \
+		*dst++ = *src; \
+		crc = T[0][*src++ ^ (crc & 0xff)] ^ crc >> 8; \
+	} \
+	for (; n >= 8; n -= 8, src += 8, dst += 8) { \
+		uint64_t w = *(const uint64_t*)src, x = w ^ crc; \
+		CRC_COPY_STORE8(dst, w) \
+		crc = CRC_COPY_SLICE8(T, x); \
+	} \
+	for (; n; n--) { \
+		*dst++ = *src; \
+		crc = T[0][*src++ ^ (crc & 0xff)] ^ crc >> 8; \
+	} \
+	CRC_COPY_SFENCE(nt) \
+	return ~crc;
+
+uint32_t crc32_slice8_copy(uint8_t *dst, const uint8_t *src, size_t n, uint32_t crc) {
+	CRC_COPY_SLICE(crc32_table16)
+}
+
+uint64_t crc64_slice8_copy(uint8_t *dst, const uint8_t *src, size_t n, uint64_t crc) {
+	CRC_COPY_SLICE(crc64_table16)
+}
+
+#if HAVE_CLMUL && !defined(__aarch64__)
+#define CRC_COPY_FOLD(x, y, k) \
+	_mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), \
+			_mm_clmulepi64_si128(x, k, 0x11)), y)
+
+#define CRC_COPY_LOOP(store) \
+	for (; n >= 64; n -= 64, src += 64, dst += 64) { \
+		__m128i *d = (__m128i*)dst; \
+		d0 = _mm_loadu_si128((const __m128i*)src); \
+		d1 = _mm_loadu_si128((const __m128i*)src + 1); \
+		d2 = _mm_loadu_si128((const __m128i*)src + 2); \
+		d3 = _mm_loadu_si128((const __m128i*)src + 3); \
+		store(d, d0); store(d + 1, d1); store(d + 2, d2); store(d + 3, d3); \
+		v0 = CRC_COPY_FOLD(v0, d0, vfold64); \
+		v1 = CRC_COPY_FOLD(v1, d1, vfold64); \
+		v2 = CRC_COPY_FOLD(v2, d2, vfold64); \
+		v3 = CRC_COPY_FOLD(v3, d3, vfold64); \
+	}
+
+/*
+ * up to dst aligned to 16 and the rest after the 64-byte blocks through
+ * crc_clmul.h, the blocks in 4 streams with the initial value xored in
+ */
+#define CRC_COPY_CLMUL(crc2vec, reduce, kernel) \
+	int nt = n >= crc_copy_nt; \
+	size_t h = n < 128 ? n : -(uintptr_t)dst & 15; \
+	__m128i v0, v1, v2, v3, d0, d1, d2, d3; \
+	\
+	if (h) { \
+		memcpy(dst, src, h); \
+		crc = kernel(src, h, crc); \
+		dst += h; src += h; n -= h; \
+	} \
+	if (n >= 64) { \
+		__m128i *d = (__m128i*)dst; \
+		v0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)src), crc2vec); \
+		v1 = _mm_loadu_si128((const __m128i*)src + 1); \
+		v2 = _mm_loadu_si128((const __m128i*)src + 2); \
+		v3 = _mm_loadu_si128((const __m128i*)src + 3); \
+		_mm_store_si128(d, _mm_loadu_si128((const __m128i*)src)); \
+		_mm_store_si128(d + 1, v1); _mm_store_si128(d + 2, v2); _mm_store_si128(d + 3, v3); \
+		n -= 64; src += 64; dst += 64; \
+		if (nt) { \
+			CRC_COPY_LOOP(_mm_stream_si128) \
+		} else { \
+			CRC_COPY_LOOP(_mm_store_si128) \
+		} \
+		v0 = CRC_COPY_FOLD(v0, v1, vfold16); \
+		v0 = CRC_COPY_FOLD(v0, v2, vfold16); \
+		v0 = CRC_COPY_FOLD(v0, v3, vfold16); \
+		crc = reduce(v0, _mm_srli_si128(v0, 8)); \
+	} \
+	if (n) { \
+		memcpy(dst, src, n); \
+		crc = kernel(src, n, crc); \
+	} \
+	CRC_COPY_SFENCE(nt) \
+	return crc;
+
+uint32_t crc32_clmul_copy(uint8_t *dst, const uint8_t *src, size_t n, uint32_t crc) {
+	// uint32_t p = 0xedb88320;
+	uint64_t i3 = 0x0ccaa009e; // calc_hi(p, p, 64) << 1
+	uint64_t i4 = 0x1751997d0; // calc_hi(p, p, 128) << 1
+	uint64_t i5 = 0x1c6e41596; // calc_hi(p, p, 448) << 1
+	uint64_t i6 = 0x154442bd4; // calc_hi(p, p, 512) << 1
+	__m128i vfold16 = _mm_set_epi64x(i3, i4);
+	__m128i vfold64 = _mm_set_epi64x(i5, i6);
+
+	CRC_COPY_CLMUL(_mm_cvtsi32_si128(~crc), crc32_clmul_reduce, crc32_clmul)
+}
+
+uint64_t crc64_clmul_copy(uint8_t *dst, const uint8_t *src, size_t n, uint64_t crc) {
+	// uint64_t p = 0xc96c5795d7870f42;
+	uint64_t i2 = 0xdabe95afc7875f40; // calc_hi(p, 1, 64)
+	uint64_t i3 = 0xe05dd497ca393ae4; // calc_hi(p, i2, 64)
+	uint64_t i4 = 0x081f6054a7842df4; // calc_hi(p, 1, 448)
+	uint64_t i5 = 0x6ae3efbb9dd441f3; // calc_hi(p, 1, 512)
+	__m128i vfold16 = _mm_set_epi64x(i2, i3);
+	__m128i vfold64 = _mm_set_epi64x(i4, i5);
+
+	CRC_COPY_CLMUL(_mm_set_epi64x(0, ~crc), crc64_clmul_reduce, crc64_clmul)
+}
+
+#undef CRC_COPY_CLMUL
+#undef CRC_COPY_LOOP
+#undef CRC_COPY_FOLD
+#elif HAVE_CLMUL
+uint32_t crc32_clmul_copy(uint8_t *dst, const uint8_t *src, size_t n, uint32_t crc) {
+	CRC_COPY_CHUNKED(uint32_t, crc32_clmul)
+}
+
+uint64_t crc64_clmul_copy(uint8_t *dst, const uint8_t *src, size_t n, uint64_t crc) {
+	CRC_COPY_CHUNKED(uint64_t, crc64_clmul)
+}
+#endif
+
+#if HAVE_CLMUL
+#define crc32_copy crc32_clmul_copy
+#define crc64_copy crc64_clmul_copy
+#else
+#define crc32_copy crc32_slice8_copy
+#define crc64_copy crc64_slice8_copy
+#endif
+
+#undef CRC_COPY_SLICE
+#undef CRC_COPY_STORE8
+#undef CRC_COPY_SLICE8
+#undef CRC_COPY_CHUNKED
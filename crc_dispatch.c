@@ -0,0 +1,192 @@
+/*
+ * Runtime dispatch for crc32()/crc64(): picks the fastest kernel for
+ * this CPU at the first call and caches it in a function pointer for
+ * each size class, so later calls are a single indirect call with no
+ * feature checks.
+ *
+ * The choice per size class comes from crc_tune.h if built with
+ * -DWITH_TUNE (written by ./main -t tune), the kernels named there that
+ * this CPU can't run are replaced by the default choice.
+ *
+ * This file is built for the baseline ISA, the kernels that need more
+ * are in their own translation units (crc_x86_*.c, crc_arm64.c).
+ * cc -O3 -c crc_dispatch.c
+ */
+
+#include "crc_dispatch.h"
+
+#include <string.h>
+
+/* fallback, lookup tables and CLMUL simulation */
+#define crc32_slice4 crc32_slice4_generic
+#define crc64_slice4 crc64_slice4_generic
+#define crc32_slice4_init crc32_slice4_init_generic
+#define crc64_slice4_init crc64_slice4_init_generic
+#include "crc_slice.h"
+#define crc32_slice8 crc32_slice8_generic
+#define crc64_slice8 crc64_slice8_generic
+#define crc32_slice16 crc32_slice16_generic
+#define crc64_slice16 crc64_slice16_generic
+#include "crc_slice16.h"
+#define crc32_clsim crc32_clsim_generic
+#define crc64_clsim crc64_clsim_generic
+#define crc32_clsim_2x crc32_clsim_2x_generic
+#define crc64_clsim_2x crc64_clsim_2x_generic
+#define crc32_clsim_4x crc32_clsim_4x_generic
+#define crc64_clsim_4x crc64_clsim_4x_generic
+#include "crc_clsim.h"
+
+#ifdef WITH_TUNE
+#include "crc_tune.h"
+#endif
+
+typedef uint32_t (*crc32_fn_t)(const uint8_t*, size_t, uint32_t);
+typedef uint64_t (*crc64_fn_t)(const uint8_t*, size_t, uint64_t);
+
+#if defined(__i386__) || defined(__x86_64__)
+uint32_t crc32_clmul_x86(const uint8_t*, size_t, uint32_t);
+uint64_t crc64_clmul_x86(const uint8_t*, size_t, uint64_t);
+uint32_t crc32_vpclmul_avx2(const uint8_t*, size_t, uint32_t);
+uint64_t crc64_vpclmul_avx2(const uint8_t*, size_t, uint64_t);
+uint32_t crc32_vpclmul_avx512(const uint8_t*, size_t, uint32_t);
+uint64_t crc64_vpclmul_avx512(const uint8_t*, size_t, uint64_t);
+#elif defined(__aarch64__)
+#ifdef __linux__
+#include <sys/auxv.h>
+#endif
+uint32_t crc32_clmul_armv8(const uint8_t*, size_t, uint32_t);
+uint64_t crc64_clmul_armv8(const uint8_t*, size_t, uint64_t);
+uint32_t crc32_arm_armv8(const uint8_t*, size_t, uint32_t);
+#endif
+
+static uint32_t crc32_first(const uint8_t *data, size_t length, uint32_t crc);
+static uint64_t crc64_first(const uint8_t *data, size_t length, uint64_t crc);
+
+/* one per size class */
+static crc32_fn_t crc32_ptr[CRC_TUNE_CLASSES] = {
+	crc32_first, crc32_first, crc32_first, crc32_first,
+	crc32_first, crc32_first, crc32_first
+};
+static crc64_fn_t crc64_ptr[CRC_TUNE_CLASSES] = {
+	crc64_first, crc64_first, crc64_first, crc64_first,
+	crc64_first, crc64_first, crc64_first
+};
+static const char *crc32_name[CRC_TUNE_CLASSES], *crc64_name[CRC_TUNE_CLASSES];
+
+/* the kernels this CPU can run, the default choice is the last one */
+static crc_kernel_t crc_kernel_list[24];
+
+static void crc_kernel_add(int *n, const char *name, crc32_fn_t fn32, crc64_fn_t fn64) {
+	crc_kernel_t *k = &crc_kernel_list[(*n)++];
+	k->name = name; k->fn32 = fn32; k->fn64 = fn64;
+}
+
+/* writes the same values each time, may run on several threads at once */
+static void crc_kernels_init(void) {
+	int n = 0;
+	crc32_slice4_init_generic();
+	crc64_slice4_init_generic();
+	crc_kernel_add(&n, "crc32_slice4", crc32_slice4_generic, NULL);
+	crc_kernel_add(&n, "crc64_slice4", NULL, crc64_slice4_generic);
+	crc_kernel_add(&n, "crc32_slice16", crc32_slice16_generic, NULL);
+	crc_kernel_add(&n, "crc64_slice16", NULL, crc64_slice16_generic);
+	crc_kernel_add(&n, "crc32_clsim", crc32_clsim_generic, NULL);
+	crc_kernel_add(&n, "crc64_clsim", NULL, crc64_clsim_generic);
+	crc_kernel_add(&n, "crc32_clsim_4x", crc32_clsim_4x_generic, NULL);
+	crc_kernel_add(&n, "crc64_clsim_4x", NULL, crc64_clsim_4x_generic);
+
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("pclmul")) {
+		crc_kernel_add(&n, "crc32_clmul", crc32_clmul_x86, NULL);
+		crc_kernel_add(&n, "crc64_clmul", NULL, crc64_clmul_x86);
+		if (__builtin_cpu_supports("vpclmulqdq") && __builtin_cpu_supports("avx2")) {
+			crc_kernel_add(&n, "crc32_vpclmul_avx2", crc32_vpclmul_avx2, NULL);
+			crc_kernel_add(&n, "crc64_vpclmul_avx2", NULL, crc64_vpclmul_avx2);
+		}
+		if (__builtin_cpu_supports("vpclmulqdq") &&
+				__builtin_cpu_supports("avx512bw") &&
+				__builtin_cpu_supports("avx512vl")) {
+			crc_kernel_add(&n, "crc32_vpclmul_avx512", crc32_vpclmul_avx512, NULL);
+			crc_kernel_add(&n, "crc64_vpclmul_avx512", NULL, crc64_vpclmul_avx512);
+		}
+	}
+#elif defined(__aarch64__)
+#ifdef __linux__
+	unsigned long hwcap = getauxval(AT_HWCAP);
+	int crc = !!(hwcap & HWCAP_CRC32), pmull = !!(hwcap & HWCAP_PMULL);
+#elif defined(__APPLE__)
+	int crc = 1, pmull = 1;
+#else
+	int crc = 0, pmull = 0;
+#endif
+	if (crc) crc_kernel_add(&n, "crc32_arm", crc32_arm_armv8, NULL);
+	if (pmull) {
+		crc_kernel_add(&n, "crc32_clmul", crc32_clmul_armv8, NULL);
+		crc_kernel_add(&n, "crc64_clmul", NULL, crc64_clmul_armv8);
+	}
+#endif
+}
+
+static const crc_kernel_t *crc_kernel_find(const char *name, int bits) {
+	const crc_kernel_t *k, *last = NULL;
+	for (k = crc_kernel_list; k->name; k++) {
+		if (bits == 32 ? !k->fn32 : !k->fn64) continue;
+		if (name && !strcmp(k->name, name)) return k;
+		last = k;
+	}
+	return last;
+}
+
+/* the same choice on every thread, so a race here is harmless */
+static void crc_dispatch_init(void) {
+	const crc_kernel_t *k; int i;
+	crc_kernels_init();
+	for (i = 0; i < CRC_TUNE_CLASSES; i++) {
+#ifdef WITH_TUNE
+		k = crc_kernel_find(crc32_tune[i], 32);
+#else
+		k = crc_kernel_find(NULL, 32);
+#endif
+		crc32_name[i] = k->name; crc32_ptr[i] = k->fn32;
+#ifdef WITH_TUNE
+		k = crc_kernel_find(crc64_tune[i], 64);
+#else
+		k = crc_kernel_find(NULL, 64);
+#endif
+		crc64_name[i] = k->name; crc64_ptr[i] = k->fn64;
+	}
+}
+
+static uint32_t crc32_first(const uint8_t *data, size_t length, uint32_t crc) {
+	crc_dispatch_init();
+	return crc32(data, length, crc);
+}
+
+static uint64_t crc64_first(const uint8_t *data, size_t length, uint64_t crc) {
+	crc_dispatch_init();
+	return crc64(data, length, crc);
+}
+
+uint32_t crc32(const uint8_t *data, size_t length, uint32_t crc) {
+	return crc32_ptr[crc_tune_class(length)](data, length, crc);
+}
+
+uint64_t crc64(const uint8_t *data, size_t length, uint64_t crc) {
+	return crc64_ptr[crc_tune_class(length)](data, length, crc);
+}
+
+const char *crc32_kernel(size_t length) {
+	if (!crc32_name[0]) crc_dispatch_init();
+	return crc32_name[crc_tune_class(length)];
+}
+
+const char *crc64_kernel(size_t length) {
+	if (!crc64_name[0]) crc_dispatch_init();
+	return crc64_name[crc_tune_class(length)];
+}
+
+const crc_kernel_t *crc_kernels(void) {
+	if (!crc_kernel_list[0].name) crc_kernels_init();
+	return crc_kernel_list;
+}
@@ -0,0 +1,33 @@
+/*
+ * CRC32 (PKZIP) and CRC64 (XZ) with the fastest kernel for this CPU,
+ * selected at the first call, separately for each size class.
+ *
+ * Link with crc_dispatch.c and the per-ISA objects (see README).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint32_t crc32(const uint8_t *data, size_t length, uint32_t crc);
+uint64_t crc64(const uint8_t *data, size_t length, uint64_t crc);
+
+/* name of the kernel selected for this length */
+const char *crc32_kernel(size_t length);
+const char *crc64_kernel(size_t length);
+
+/* size classes by 4x: <64, <256, <1K, <4K, <16K, <64K and the rest */
+#define CRC_TUNE_CLASSES 7
+
+static inline int crc_tune_class(size_t length) {
+	int c = (63 - __builtin_clzll((unsigned long long)length | 1) - 4) >> 1;
+	return c < 0 ? 0 : c < CRC_TUNE_CLASSES - 1 ? c : CRC_TUNE_CLASSES - 1;
+}
+
+typedef struct {
+	const char *name;
+	uint32_t (*fn32)(const uint8_t*, size_t, uint32_t);
+	uint64_t (*fn64)(const uint8_t*, size_t, uint64_t);
+} crc_kernel_t;
+
+/* kernels usable on this CPU, for the autotuner, ends with a NULL name */
+const crc_kernel_t *crc_kernels(void);
@@ -0,0 +1,87 @@
+/*
+ * CRC32 using the CRC32 instructions: PKZIP polynomial on ARMv8,
+ * CRC-32C (Castagnoli) polynomial on x86 with SSE4.2.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __ARM_FEATURE_CRC32
+#include <arm_acle.h>
+uint32_t crc32_arm(const uint8_t *s, size_t n, uint32_t c) {
+	c = ~c;
+#ifdef __aarch64__
+	if (n >= 8) {
+		const uint8_t *e;
+		uintptr_t x = -(uintptr_t)s & 7;
+		if (x & 1) c = __crc32b(c, *s);
+		if (x & 2) c = __crc32h(c, *(uint16_t*)(s + (x & 1)));
+		if (x & 4) c = __crc32w(c, *(uint32_t*)(s + (x & 3)));
+		n -= x; s += x;
+		e = s + n - 7;
+		for (; s < e; s += 8) c = __crc32d(c, *(uint64_t*)s);
+		if (n & 4) c = __crc32w(c, *(uint32_t*)s);
+		if (n & 2) c = __crc32h(c, *(uint16_t*)(s + (n & 4)));
+		if (n & 1) c = __crc32b(c, s[n & 6]);
+	}
+#else
+	if (n >= 4) {
+		const uint8_t *e;
+		uintptr_t x = -(uintptr_t)s & 3;
+		if (x & 1) c = __crc32b(c, *s);
+		if (x & 2) c = __crc32h(c, *(uint16_t*)(s + (x & 1)));
+		n -= x; s += x;
+		e = s + n - 3;
+		for (; s < e; s += 4) c = __crc32w(c, *(uint32_t*)s);
+		if (n & 2) c = __crc32h(c, *(uint16_t*)s);
+		if (n & 1) c = __crc32b(c, s[n & 2]);
+	}
+#endif
+	else
+		for (; n; n--) c = __crc32b(c, *s++);
+	return ~c;
+}
+#endif
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+uint32_t crc32_intel(const uint8_t *s, size_t n, uint32_t c) {
+	c = ~c;
+#ifndef __i386__
+	if (n >= 8) {
+		const uint8_t *e;
+		uintptr_t x = -(uintptr_t)s & 7;
+		if (x & 1) c = _mm_crc32_u8(c, *s);
+		if (x & 2) c = _mm_crc32_u16(c, *(uint16_t*)(s + (x & 1)));
+		if (x & 4) c = _mm_crc32_u32(c, *(uint32_t*)(s + (x & 3)));
+		n -= x; s += x;
+		e = s + n - 7;
+		// Avoid redundant zero extensions in the loop
+		// https://gcc.gnu.org/bugzilla/show_bug.cgi?id=106453
+		{
+			uint64_t xc = c;
+			for (; s < e; s += 8) xc = _mm_crc32_u64(xc, *(uint64_t*)s);
+			c = xc;
+		}
+		if (n & 4) c = _mm_crc32_u32(c, *(uint32_t*)s);
+		if (n & 2) c = _mm_crc32_u16(c, *(uint16_t*)(s + (n & 4)));
+		if (n & 1) c = _mm_crc32_u8(c, s[n & 6]);
+	}
+#else
+	if (n >= 4) {
+		const uint8_t *e;
+		uintptr_t x = -(uintptr_t)s & 3;
+		if (x & 1) c = _mm_crc32_u8(c, *s);
+		if (x & 2) c = _mm_crc32_u16(c, *(uint16_t*)(s + (x & 1)));
+		n -= x; s += x;
+		e = s + n - 3;
+		for (; s < e; s += 4) c = _mm_crc32_u32(c, *(uint32_t*)s);
+		if (n & 2) c = _mm_crc32_u16(c, *(uint16_t*)s);
+		if (n & 1) c = _mm_crc32_u8(c, s[n & 2]);
+	}
+#endif
+	else
+		for (; n; n--) c = _mm_crc32_u8(c, *s++);
+	return ~c;
+}
+#endif
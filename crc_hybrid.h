@@ -0,0 +1,154 @@
+/*
+ * CRC-32C using the CRC32 instructions and CLMUL folding at the same
+ * time, as they run on different execution units. Each block is split
+ * into a stripe folded with CLMUL (4 x 16 bytes per iteration) and
+ * CRC_HYBRID_STREAMS stripes for crc32 instruction chains, `words` 8-byte
+ * words per chain per iteration. The stripe CRCs are merged with a CLMUL
+ * by x^(8 * n - 33) mod P, followed by a crc32 of the 64-bit product, so
+ * there is no crc32_multmodp in the loop.
+ *
+ * The best `words` depends on the CRC32 and CLMUL throughput of the CPU.
+ *
+ * x86-64 with SSE4.2 and PCLMUL, or AArch64 with CRC and PMULL.
+ * Requires "crc_combine.h".
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CRC_HYBRID_STREAMS 3
+
+typedef struct {
+	int words; size_t iters, block;
+	/* shifts over the stripes after: the CLMUL one, then the crc32 ones */
+	uint32_t k[CRC_HYBRID_STREAMS];
+} crc_hybrid_t;
+
+/* returns non-zero if not supported, block is rounded down */
+static int crc32c_hybrid_init(crc_hybrid_t *t, int words, size_t block) {
+	size_t lc; int j;
+	if (words < 1 || words > 4) return 1;
+	t->words = words;
+	t->iters = block / (64 + CRC_HYBRID_STREAMS * 8 * words);
+	if (!t->iters) t->iters = 1;
+	lc = 8 * words * t->iters;
+	t->block = 64 * t->iters + CRC_HYBRID_STREAMS * lc;
+	for (j = 0; j < CRC_HYBRID_STREAMS; j++)
+		t->k[j] = crc32_xnmodp(0x82f63b78, 8 * lc * (CRC_HYBRID_STREAMS - j) - 33);
+	return 0;
+}
+
+#if defined(__x86_64__) && defined(__SSE4_2__) && defined(__PCLMUL__)
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+
+#define CRC_HYBRID 1
+#define HYB_CRC(c, w) c = _mm_crc32_u64(c, w);
+#define HYB_VEC __m128i
+#define HYB_LOAD(p) _mm_loadu_si128((const __m128i*)(p))
+#define HYB_INIT(p, c) _mm_xor_si128(HYB_LOAD(p), _mm_cvtsi32_si128(c))
+#define HYB_FOLD(x, k, d) \
+	x = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), \
+			_mm_clmulepi64_si128(x, k, 0x11)), d);
+#define HYB_SET(hi, lo) _mm_set_epi64x(hi, lo)
+#define HYB_LO(x) (uint64_t)_mm_cvtsi128_si64(x)
+#define HYB_HI(x) (uint64_t)_mm_extract_epi64(x, 1)
+#define HYB_SHIFT(c, k) (uint32_t)_mm_crc32_u64(0, _mm_cvtsi128_si64( \
+		_mm_clmulepi64_si128(_mm_cvtsi32_si128(c), _mm_cvtsi32_si128(k), 0x00)))
+#define HYB_TAIL(s, n, c) crc32_intel(s, n, c)
+
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32) && defined(__ARM_FEATURE_CRYPTO)
+#include <arm_acle.h>
+#include <arm_neon.h>
+
+#define CRC_HYBRID 1
+#define HYB_CRC(c, w) c = __crc32cd(c, w);
+#define HYB_VEC uint64x2_t
+#define HYB_LOAD(p) vld1q_u64((const uint64_t*)(p))
+#define HYB_INIT(p, c) veorq_u64(HYB_LOAD(p), vcombine_u64(vcreate_u64(c), vcreate_u64(0)))
+#define HYB_FOLD(x, k, d) \
+	x = veorq_u64(veorq_u64(vreinterpretq_u64_p128(vmull_p64( \
+			vgetq_lane_u64(x, 0), vgetq_lane_u64(k, 0))), \
+		vreinterpretq_u64_p128(vmull_high_p64( \
+			vreinterpretq_p64_u64(x), vreinterpretq_p64_u64(k)))), d);
+#define HYB_SET(hi, lo) vcombine_u64(vcreate_u64(lo), vcreate_u64(hi))
+#define HYB_LO(x) vgetq_lane_u64(x, 0)
+#define HYB_HI(x) vgetq_lane_u64(x, 1)
+#define HYB_SHIFT(c, k) __crc32cd(0, (uint64_t)vmull_p64(c, k))
+
+static uint32_t crc32c_arm(const uint8_t *s, size_t n, uint32_t c) {
+	c = ~c;
+	for (; n >= 8; n -= 8, s += 8) c = __crc32cd(c, *(const uint64_t*)s);
+	for (; n; n--) c = __crc32cb(c, *s++);
+	return ~c;
+}
+#define HYB_TAIL(s, n, c) crc32c_arm(s, n, c)
+#endif
+
+#ifdef CRC_HYBRID
+/* the chains of one iteration */
+#define HYB_WORDS(W) \
+	for (j = 0; j < W; j++, q++) { \
+		HYB_CRC(c0, q[0]) HYB_CRC(c1, q[l8]) HYB_CRC(c2, q[2 * l8]) \
+	}
+
+#define HYB_BLOCKS(W) \
+	for (; n >= t->block; s += t->block, n -= t->block) { \
+		const uint8_t *p = s; \
+		const uint64_t *q = (const uint64_t*)(s + 64 * N); \
+		uint64_t c0 = 0, c1 = 0, c2 = 0; \
+		HYB_VEC x0, x1, x2, x3; \
+		size_t i; int j; \
+		x0 = HYB_INIT(p, c); x1 = HYB_LOAD(p + 16); \
+		x2 = HYB_LOAD(p + 32); x3 = HYB_LOAD(p + 48); \
+		for (i = 1; i < N; i++) { \
+			HYB_WORDS(W) \
+			p += 64; \
+			HYB_FOLD(x0, vfold64, HYB_LOAD(p)) \
+			HYB_FOLD(x1, vfold64, HYB_LOAD(p + 16)) \
+			HYB_FOLD(x2, vfold64, HYB_LOAD(p + 32)) \
+			HYB_FOLD(x3, vfold64, HYB_LOAD(p + 48)) \
+		} \
+		HYB_WORDS(W) \
+		HYB_FOLD(x0, vfold16, x1) \
+		HYB_FOLD(x0, vfold16, x2) \
+		HYB_FOLD(x0, vfold16, x3) \
+		c = 0; HYB_CRC(c, HYB_LO(x0)) HYB_CRC(c, HYB_HI(x0)) \
+		c = HYB_SHIFT(c, t->k[0]) ^ HYB_SHIFT((uint32_t)c0, t->k[1]) ^ \
+			HYB_SHIFT((uint32_t)c1, t->k[2]) ^ (uint32_t)c2; \
+	}
+
+uint32_t crc32c_hybrid_run(const crc_hybrid_t *t, const uint8_t *s, size_t n, uint32_t c32) {
+	// uint32_t p = 0x82f63b78;
+	uint64_t i3 = 0x14cd00bd6; // calc_hi(p, p, 64) << 1
+	uint64_t i4 = 0x0f20c0dfe; // calc_hi(p, p, 128) << 1
+	uint64_t i5 = 0x09e4addf8; // calc_hi(p, p, 448) << 1
+	uint64_t i6 = 0x0740eef02; // calc_hi(p, p, 512) << 1
+	HYB_VEC vfold16 = HYB_SET(i3, i4);
+	HYB_VEC vfold64 = HYB_SET(i5, i6);
+	size_t N = t->iters, l8 = t->words * N;
+	uint64_t c = c32;
+
+	c = ~c;
+	switch (t->words) {
+	case 1: HYB_BLOCKS(1) break;
+	case 2: HYB_BLOCKS(2) break;
+	case 3: HYB_BLOCKS(3) break;
+	case 4: HYB_BLOCKS(4) break;
+	}
+	return HYB_TAIL(s, n, ~(uint32_t)c);
+}
+
+#undef HYB_BLOCKS
+#undef HYB_WORDS
+#undef HYB_CRC
+#undef HYB_VEC
+#undef HYB_LOAD
+#undef HYB_INIT
+#undef HYB_FOLD
+#undef HYB_SET
+#undef HYB_LO
+#undef HYB_HI
+#undef HYB_SHIFT
+#undef HYB_TAIL
+#endif
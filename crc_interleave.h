@@ -0,0 +1,171 @@
+/*
+ * N-way interleaving of any per-word CRC step: K streams of N bytes are
+ * processed at once, with independent dependency chains, then merged
+ * with multiplications by x^(8 * N * j) mod P computed at init time.
+ *
+ * step(crc, word) must work on the raw (not inverted) state.
+ *
+ * CRC_INTERLEAVE_TIERS runs several such layouts from the longest to the
+ * shortest, so the rest of a long buffer and medium buffers also get
+ * parallel streams. For crc32 the merge uses 4-bit tables of the
+ * multiplications, which is cheap enough for 256-byte stripes.
+ *
+ * Requires "crc_combine.h".
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__aarch64__) && defined(__linux__)
+#include <stdio.h>
+#include <unistd.h>
+#endif
+
+#define CRC_INTERLEAVE_MAX 8
+
+#define CRC_INTERLEAVE_TIERS_MAX 3
+
+typedef struct {
+	int streams; size_t block;
+	/* m[k] = x^(8 * block * (streams - 1 - k)) mod P */
+	uint64_t m[CRC_INTERLEAVE_MAX - 1];
+	/* crc32 only: mt[k][i][d] = (d << 4 * i) * m[k] mod P */
+	uint32_t mt[CRC_INTERLEAVE_MAX - 1][8][16];
+} crc_interleave_t;
+
+/* stripe layouts, the longest first */
+typedef struct {
+	int tiers;
+	crc_interleave_t t[CRC_INTERLEAVE_TIERS_MAX];
+} crc_interleave_tiers_t;
+
+/* a * m mod P, using the tables of m */
+static inline uint32_t crc32_multtab(const uint32_t *mt, uint32_t a) {
+	return mt[a & 15] ^ mt[16 + (a >> 4 & 15)] ^ mt[32 + (a >> 8 & 15)] ^
+		mt[48 + (a >> 12 & 15)] ^ mt[64 + (a >> 16 & 15)] ^ mt[80 + (a >> 20 & 15)] ^
+		mt[96 + (a >> 24 & 15)] ^ mt[112 + (a >> 28)];
+}
+
+/* returns non-zero if the stream count is not supported */
+static int crc32_interleave_init(crc_interleave_t *t, uint32_t p, int streams, size_t block) {
+	int k, i, d;
+	if (streams != 3 && streams != 4 && streams != 6 && streams != 8) return 1;
+	if (!block || block & 7) return 1;
+	t->streams = streams; t->block = block;
+	for (k = 0; k < streams - 1; k++) {
+		t->m[k] = crc32_x8nmodp(p, block * (streams - 1 - k));
+		for (i = 0; i < 8; i++)
+		for (d = 0; d < 16; d++)
+			t->mt[k][i][d] = d ? crc32_multmodp(p, (uint32_t)d << 4 * i, t->m[k]) : 0;
+	}
+	return 0;
+}
+
+static int crc64_interleave_init(crc_interleave_t *t, uint64_t p, int streams, size_t block) {
+	int k;
+	if (streams != 3 && streams != 4 && streams != 6 && streams != 8) return 1;
+	if (!block || block & 7) return 1;
+	t->streams = streams; t->block = block;
+	for (k = 0; k < streams - 1; k++)
+		t->m[k] = crc64_x8nmodp(p, block * (streams - 1 - k));
+	return 0;
+}
+
+/*
+ * Stripe profiles for crc32_interleave_tiers_init: "ooo" for out-of-order
+ * cores, "inorder" for in-order ones (Cortex-A53/A55), where K streams far
+ * apart cost more than they give; "auto" picks one for the running CPU.
+ */
+typedef struct {
+	const char *name; int tiers;
+	int streams[CRC_INTERLEAVE_TIERS_MAX];
+	size_t block[CRC_INTERLEAVE_TIERS_MAX];
+} crc_interleave_profile_t;
+
+static const crc_interleave_profile_t crc_interleave_profiles[] = {
+	{ "ooo", 3, { 4, 3, 3 }, { 4096, 1024, 256 } },
+	{ "inorder", 2, { 3, 3 }, { 1024, 256 } },
+	{ NULL, 0, { 0 }, { 0 } }
+};
+
+/*
+ * "inorder" if every core is an in-order Arm one by MIDR part number,
+ * else "ooo": on big.LITTLE the thread may run on a big core
+ */
+static const char *crc_interleave_detect(void) {
+#if defined(__aarch64__) && defined(__linux__)
+	long cpu, ncpu = sysconf(_SC_NPROCESSORS_CONF);
+	int found = 0;
+	for (cpu = 0; cpu < ncpu; cpu++) {
+		char name[96];
+		unsigned long long midr;
+		FILE *f;
+		snprintf(name, sizeof(name),
+				"/sys/devices/system/cpu/cpu%ld/regs/identification/midr_el1", cpu);
+		/* offline cores have no regs */
+		if (!(f = fopen(name, "r"))) continue;
+		if (fscanf(f, "%llx", &midr) != 1) midr = 0;
+		fclose(f);
+		switch (midr >> 24 == 0x41 ? (midr >> 4 & 0xfff) : 0) {
+		case 0xd03: case 0xd04: case 0xd05: case 0xd46: found = 1; continue;
+		}
+		return "ooo";
+	}
+	if (found) return "inorder";
+#endif
+	return "ooo";
+}
+
+/* a profile name, or a single layout if streams != 0 */
+static int crc32_interleave_tiers_init(crc_interleave_tiers_t *a, uint32_t p,
+		const char *profile, int streams, size_t block) {
+	const crc_interleave_profile_t *q;
+	int i;
+	if (streams) {
+		a->tiers = 1;
+		return crc32_interleave_init(&a->t[0], p, streams, block);
+	}
+	if (!strcmp(profile, "auto")) profile = crc_interleave_detect();
+	for (q = crc_interleave_profiles; q->name && strcmp(q->name, profile); q++);
+	if (!q->name) return 1;
+	a->tiers = q->tiers;
+	for (i = 0; i < q->tiers; i++)
+		if (crc32_interleave_init(&a->t[i], p, q->streams[i], q->block[i])) return 1;
+	return 0;
+}
+
+/* merges for CRC_INTERLEAVE: a * m[k] mod P */
+#define CRC32_MERGE(P, t, k, a) crc32_multtab((t)->mt[k][0], a)
+/* bitwise, a CLMUL crc64_combine_mul here made crc64_clsim_long 1.6x slower */
+#define CRC64_MERGE(P, t, k, a) crc64_multmodp(P, (t)->m[k], a)
+
+#define CRC_INTERLEAVE_K(step, T1, T, K, t, mul, P) \
+	for (; n >= N * K; n -= N * K) { \
+		const uint8_t *e = s + N; \
+		T1 cs[K]; int k; \
+		for (cs[0] = c, k = 1; k < K; k++) cs[k] = 0; \
+		for (; s < e; s += sizeof(T)) \
+			for (k = 0; k < K; k++) \
+				cs[k] = step(cs[k], *(const T*)(s + N * k)); \
+		s += N * (K - 1); \
+		for (c = cs[K - 1], k = 0; k < K - 1; k++) \
+			c ^= mul(P, t, k, cs[k]); \
+	}
+
+/* processes whole groups of blocks, the rest is left in (s, n) */
+#define CRC_INTERLEAVE(step, T1, T, t, mul, P) { \
+	size_t N = (t)->block; \
+	switch ((t)->streams) { \
+	case 3: CRC_INTERLEAVE_K(step, T1, T, 3, t, mul, P) break; \
+	case 4: CRC_INTERLEAVE_K(step, T1, T, 4, t, mul, P) break; \
+	case 6: CRC_INTERLEAVE_K(step, T1, T, 6, t, mul, P) break; \
+	case 8: CRC_INTERLEAVE_K(step, T1, T, 8, t, mul, P) break; \
+	} \
+}
+
+/* the same with each tier in turn */
+#define CRC_INTERLEAVE_TIERS(step, T1, T, a, mul, P) { \
+	int tier; \
+	for (tier = 0; tier < (a)->tiers; tier++) \
+		CRC_INTERLEAVE(step, T1, T, &(a)->t[tier], mul, P) \
+}
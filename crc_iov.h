@@ -0,0 +1,123 @@
+/*
+ * CRC32 (PKZIP) and CRC64 (XZ) of a scatter-gather list, as one message.
+ * The fold state, the last 64 bytes in 4 registers, stays in registers
+ * across the segments, and there is one final reduction. A segment of n
+ * bytes first shifts its n % 16 leading bytes into the state (with
+ * shuffles, no copy), then folds whole unaligned blocks by 64 bytes, so
+ * even short segments keep 4 independent CLMUL chains.
+ * The initial value is xored into the first bytes of the message, which
+ * may span several short segments; messages shorter than it go through
+ * crc_clmul.h per segment.
+ *
+ * Short segments are loaded with 16-byte loads that stay in their page,
+ * as crc_clmul.h does with aligned loads.
+ *
+ * Requires "crc_clmul.h" and "crc_batch.h" (x86 only).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+/* x folded by 16 or 64 bytes, onto y */
+#define CRC_IOV_FOLD(x, y, k) \
+	_mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), \
+			_mm_clmulepi64_si128(x, k, 0x11)), y)
+
+/* shuffles for byte shifts, see crc_batch_shuf */
+#define CRC_IOV_UP(n) _mm_loadu_si128((const __m128i*)(crc_batch_shuf + 16 - (n)))
+#define CRC_IOV_DOWN(n) _mm_loadu_si128((const __m128i*)(crc_batch_shuf + 16 + (n)))
+
+/* x holds the first r bytes of the next register */
+#define CRC_IOV_SHIFT(a, b) \
+	_mm_xor_si128(_mm_shuffle_epi8(a, dn), _mm_shuffle_epi8(b, up))
+
+/*
+ * v0..v3 are the last 64 bytes of the message so far, oldest first,
+ * with leading zeros at the start
+ */
+#define CRC_IOV_BODY(W, vcrc, reduce, kernel) \
+	__m128i v0 = _mm_setzero_si128(), v1 = v0, v2 = v0, v3 = v0, d, t; \
+	size_t total = 0; \
+	int i; \
+	\
+	for (i = 0; i < count; i++) { \
+		const uint8_t *p = (const uint8_t*)iov[i].iov_base; \
+		size_t n = iov[i].iov_len, r = n & 15, nb = n / 16; \
+		const __m128i *q; \
+		total += n; \
+		if (r) { \
+			uintptr_t off = (uintptr_t)p & 4095; \
+			__m128i up = CRC_IOV_UP(16 - r), dn = CRC_IOV_DOWN(r); \
+			/* at the end of a page, from the end of the segment */ \
+			if (off > 4096 - 16 && off + r <= 4096) \
+				d = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + r - 16)), \
+						CRC_IOV_DOWN(16 - r)); \
+			else d = _mm_loadu_si128((const __m128i*)p); \
+			d = _mm_xor_si128(d, vcrc); \
+			vcrc = _mm_shuffle_epi8(vcrc, dn); \
+			/* the window moves by r bytes, the r bytes out of it fold onto v0 */ \
+			t = _mm_shuffle_epi8(v0, up); \
+			v0 = CRC_IOV_FOLD(t, CRC_IOV_SHIFT(v0, v1), vfold16); \
+			v1 = CRC_IOV_SHIFT(v1, v2); \
+			v2 = CRC_IOV_SHIFT(v2, v3); \
+			v3 = CRC_IOV_SHIFT(v3, d); \
+			p += r; \
+		} \
+		if (!nb) continue; \
+		q = (const __m128i*)p; \
+		for (; nb >= 4; nb -= 4, q += 4) { \
+			v0 = CRC_IOV_FOLD(v0, _mm_xor_si128(_mm_loadu_si128(q), vcrc), vfold64); \
+			vcrc = _mm_setzero_si128(); \
+			v1 = CRC_IOV_FOLD(v1, _mm_loadu_si128(q + 1), vfold64); \
+			v2 = CRC_IOV_FOLD(v2, _mm_loadu_si128(q + 2), vfold64); \
+			v3 = CRC_IOV_FOLD(v3, _mm_loadu_si128(q + 3), vfold64); \
+		} \
+		for (; nb; nb--) { \
+			t = CRC_IOV_FOLD(v0, _mm_xor_si128(_mm_loadu_si128(q++), vcrc), vfold64); \
+			vcrc = _mm_setzero_si128(); \
+			v0 = v1; v1 = v2; v2 = v3; v3 = t; \
+		} \
+	} \
+	/* the initial value would go past the end */ \
+	if (total < W) { \
+		for (i = 0; i < count; i++) \
+			crc = kernel((const uint8_t*)iov[i].iov_base, iov[i].iov_len, crc); \
+		return crc; \
+	} \
+	v0 = CRC_IOV_FOLD(v0, v1, vfold16); \
+	v0 = CRC_IOV_FOLD(v0, v2, vfold16); \
+	v0 = CRC_IOV_FOLD(v0, v3, vfold16); \
+	return reduce(v0, _mm_srli_si128(v0, 8));
+
+uint32_t crc32_iov(const struct iovec *iov, int count, uint32_t crc) {
+	// uint32_t p = 0xedb88320;
+	uint64_t i3 = 0x0ccaa009e; // calc_hi(p, p, 64) << 1
+	uint64_t i4 = 0x1751997d0; // calc_hi(p, p, 128) << 1
+	uint64_t i5 = 0x1c6e41596; // calc_hi(p, p, 448) << 1
+	uint64_t i6 = 0x154442bd4; // calc_hi(p, p, 512) << 1
+	__m128i vfold16 = _mm_set_epi64x(i3, i4);
+	__m128i vfold64 = _mm_set_epi64x(i5, i6);
+	__m128i vcrc = _mm_cvtsi32_si128(~crc);
+
+	CRC_IOV_BODY(4, vcrc, crc32_clmul_reduce, crc32_clmul)
+}
+
+uint64_t crc64_iov(const struct iovec *iov, int count, uint64_t crc) {
+	// uint64_t p = 0xc96c5795d7870f42;
+	uint64_t i2 = 0xdabe95afc7875f40; // calc_hi(p, 1, 64)
+	uint64_t i3 = 0xe05dd497ca393ae4; // calc_hi(p, i2, 64)
+	uint64_t i4 = 0x081f6054a7842df4; // calc_hi(p, 1, 448)
+	uint64_t i5 = 0x6ae3efbb9dd441f3; // calc_hi(p, 1, 512)
+	__m128i vfold16 = _mm_set_epi64x(i2, i3);
+	__m128i vfold64 = _mm_set_epi64x(i4, i5);
+	__m128i vcrc = _mm_set_epi64x(0, ~crc);
+
+	CRC_IOV_BODY(8, vcrc, crc64_clmul_reduce, crc64_clmul)
+}
+
+#undef CRC_IOV_BODY
+#undef CRC_IOV_SHIFT
+#undef CRC_IOV_DOWN
+#undef CRC_IOV_UP
+#undef CRC_IOV_FOLD
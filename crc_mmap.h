@@ -0,0 +1,57 @@
+/*
+ * Maps a whole input file for reading, so the CRC kernels can run on the
+ * page cache directly, without a copy into a buffer and a read() per
+ * chunk. Only for regular files, the rest (pipes, stdin) must be read.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CRC_MAP_POPULATE 1 /* prefault all pages in mmap() */
+#define CRC_MAP_SEQ 2 /* MADV_SEQUENTIAL: aggressive readahead */
+#define CRC_MAP_HUGE 4 /* MADV_HUGEPAGE: for filesystems that support it */
+
+/* comma-separated "populate", "seq", "huge", anything else is a plain mapping */
+static int crc_map_flags(const char *s) {
+	int flags = 0;
+	if (strstr(s, "populate")) flags |= CRC_MAP_POPULATE;
+	if (strstr(s, "seq")) flags |= CRC_MAP_SEQ;
+	if (strstr(s, "huge")) flags |= CRC_MAP_HUGE;
+	return flags;
+}
+
+/* size of a regular file, or -1 */
+static long long crc_file_size(FILE *f) {
+	struct stat st;
+	if (fstat(fileno(f), &st) || !S_ISREG(st.st_mode)) return -1;
+	return st.st_size;
+}
+
+/* NULL if the file can't be mapped (not a regular file, empty, ...) */
+static const uint8_t *crc_map_file(FILE *f, int flags, size_t *len) {
+	long long size = crc_file_size(f);
+	int mflags = MAP_PRIVATE;
+	void *p;
+
+	if (size <= 0 || (unsigned long long)size > (size_t)-1) return NULL;
+#ifdef MAP_POPULATE
+	if (flags & CRC_MAP_POPULATE) mflags |= MAP_POPULATE;
+#endif
+	p = mmap(NULL, size, PROT_READ, mflags, fileno(f), 0);
+	if (p == MAP_FAILED) return NULL;
+	/* only hints, the result is ignored */
+	if (flags & CRC_MAP_SEQ) madvise(p, size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+	if (flags & CRC_MAP_HUGE) madvise(p, size, MADV_HUGEPAGE);
+#endif
+	*len = size;
+	return (const uint8_t*)p;
+}
+
+static void crc_unmap_file(const uint8_t *p, size_t len) {
+	munmap((void*)p, len);
+}
@@ -0,0 +1,241 @@
+/*
+ * Non-reflected (MSB-first) CRC32 and CRC64:
+ * CRC-32/BZIP2 (poly 0x04c11db7, init and xorout ~0) and
+ * CRC-64/WE (poly 0x42f0e1eba9ea3693, init and xorout ~0).
+ * CRC-32/MPEG-2 is ~crc32_msb(s, n, 0), CRC-64/ECMA-182 is
+ * ~crc64_msb(s, n, ~0).
+ *
+ * These polynomials are the bit reversals of PKZIP and XZ ones, so the
+ * clsim code is crc_clsim.h mirrored: every shift in the other direction
+ * and big-endian loads, with the same shift/xor sequences.
+ *
+ * The CLMUL code (x86) folds 16-byte big-endian blocks with constants
+ * x^n mod P and ends with Barrett reduction, as in the Intel paper.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* the first n (1..7) bytes in the high bytes of a word */
+static inline uint64_t crc_msb_load_part(const uint8_t *s, size_t n) {
+	uint64_t t = 0; size_t i;
+	for (i = 0; i < n; i++) t |= (uint64_t)s[i] << (56 - i * 8);
+	return t;
+}
+
+uint32_t crc32_msb_clsim(const uint8_t *s, size_t n, uint32_t c) {
+	uint32_t x, y, u, v, t;
+
+#define FOLD1(v) \
+	/* shift = 6, xor = 6 */ \
+	y = v^v>>19; u = y^y>>6^y>>9; \
+	x = u^y>>2; x = u^x>>10^x>>24; \
+	/* shift = 7, xor = 6 */ \
+	y = x<<1^x<<4; u = x<<16^y^y<<1; \
+	c = x<<12^y<<22^u^u<<6;
+
+	c = ~c;
+	for (; n >= 4; n -= 4, s += 4) {
+		memcpy(&t, s, 4);
+		c ^= __builtin_bswap32(t);
+		FOLD1(c) c ^= x;
+	}
+	if (n) {
+		n <<= 3; v = c << n;
+		c = (c ^ (uint32_t)(crc_msb_load_part(s, n >> 3) >> 32)) >> (32 - n);
+		FOLD1(c) c ^= x ^ v;
+	}
+#undef FOLD1
+	return ~c;
+}
+
+uint64_t crc64_msb_clsim(const uint8_t *s, size_t n, uint64_t c) {
+	uint64_t x, v, w, t, y, u, d[2];
+
+#define FOLD1(v) \
+	/* shift = 11, xor = 12 */ \
+	t = v^v>>4; u = t^v>>22; x = t>>2; \
+	y = v^v>>6^v>>30^v>>44; \
+	t = y>>7; y ^= t^y>>11; u ^= y>>8; \
+	x ^= t^y>>9^u^u>>20; \
+	/* shift = 12, xor = 11 */ \
+	c = x^x<<18; y = c^x<<3^x<<16; \
+	u = y^y<<20^y<<26^y<<45; \
+	c = x<<36^u<<1^u<<7^c<<13^u<<9^c<<22;
+
+#define FOLD2 \
+	/* shift = 9, xor = 11 */ \
+	v = c^c>>4; y = v^c>>31; \
+	u = y>>12; u = u^(y^u)>>23; v = (v^u)>>7; \
+	v = c>>5^c>>24^v^(y^v)>>2^u^u>>8; \
+	/* shift = 12, xor = 13 */ \
+	y = c^c<<10^c<<14; w = y<<2^y<<48; \
+	u = y^y<<3^y<<25; \
+	y = c^c<<1^c<<23; w ^= u^u<<18^u<<20; \
+	w ^= y^y<<21^y<<51;
+
+#define FOLD3(x, o) \
+	/* shift = 10, xor = 10(+1) */ \
+	t = x^x>>6; y = t^x>>1; \
+	u = y>>10; v o t>>6^u; u ^= y>>1; \
+	u = y>>25^u^u>>34; t ^= u; \
+	v ^= u>>7^t>>24^t>>37; \
+	/* shift = 13, xor = 12(+1) */ \
+	y = x^x<<2^x<<28; u = y^y<<9; \
+	u = y<<24^u<<1^u<<7^u<<17; \
+	y = x^x<<14; u ^= y<<2^y<<19^y<<36; \
+	u ^= u<<8; w o u^u<<2;
+
+#define LOAD2 \
+	memcpy(d, s, 16); s += 16; n -= 16; \
+	d[0] = __builtin_bswap64(d[0]); d[1] = __builtin_bswap64(d[1]);
+
+	c = ~c;
+	if (n >= 16) {
+		LOAD2
+		c ^= d[0]; x = d[1];
+		while (n >= 16) {
+			FOLD2
+			FOLD3(x, ^=)
+			LOAD2
+			c = d[0] ^ v;
+			x = d[1] ^ w;
+		}
+		FOLD3(c, =)
+		v ^= x;
+		FOLD1(v)
+		c ^= x ^ w;
+	}
+	if (n >= 8) {
+		memcpy(d, s, 8); s += 8; n -= 8;
+		c ^= __builtin_bswap64(d[0]);
+		FOLD1(c) c ^= x;
+	}
+	if (n) {
+		n <<= 3; v = c << n;
+		c = (c ^ crc_msb_load_part(s, n >> 3)) >> (64 - n);
+		FOLD1(c) c ^= x ^ v;
+	}
+#undef LOAD2
+#undef FOLD1
+#undef FOLD2
+#undef FOLD3
+	return ~c;
+}
+
+/* crc32_clsim_4x mirrored, the 32-bit halves swap places in 64-bit words */
+#define K512(x, r, o) \
+	/* shift = 7, xor = 7(+1) */ \
+	t0 = x^x>>2; t1 = x^t0>>4; t2 = t0^t1>>4; \
+	r o t2^t1>>7^t2>>16^t1>>21^x>>31;
+#define K480(x, r, o) \
+	/* shift = 7, xor = 7(+1) */ \
+	t0 = x^x>>1; t1 = t0^t0>>8; t2 = t1^t1>>5; \
+	r o t1^t2>>2^t2>>17^t1>>18^t0>>19;
+
+uint32_t crc32_msb_clsim_4x(const uint8_t *s, size_t n, uint32_t c) {
+	uint64_t f[8], a[8], g, h, t0, t1, t2; int i;
+	if (n < 128) return crc32_msb_clsim(s, n, c);
+	memcpy(f, s, 64);
+	for (i = 0; i < 8; i++) f[i] = __builtin_bswap64(f[i]);
+	f[0] ^= (uint64_t)~c << 32;
+	for (s += 64, n -= 64; n >= 64; s += 64, n -= 64) {
+		memcpy(a, s, 64);
+		for (i = 0; i < 8; i++) {
+			g = f[i] >> 32 << 32; K512(g, h, =)
+			g = f[i] << 32; K480(g, h, ^=)
+			f[i] = h ^ __builtin_bswap64(a[i]);
+		}
+	}
+	for (i = 0; i < 8; i++) f[i] = __builtin_bswap64(f[i]);
+	c = crc32_msb_clsim((const uint8_t*)f, 64, ~(uint32_t)0);
+	return crc32_msb_clsim(s, n, c);
+}
+
+#undef K512
+#undef K480
+
+#if defined(__PCLMUL__) && defined(__SSSE3__)
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+
+#define CRC_MSB_LOAD(p) _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p)), vswap)
+
+/* x * x^128 + d, with k = (x^(128+64), x^128) mod P, or more for a wider stride */
+#define CRC_MSB_FOLD(x, k, d) \
+	x = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), \
+			_mm_clmulepi64_si128(x, k, 0x11)), d);
+
+/* the low 64 bits of a times x^W mod P, with k = (P - x^W, x^(64+W) / P - x^64) */
+#define CRC_MSB_BARRETT(a, k) \
+	a = _mm_xor_si128(_mm_srli_si128(_mm_clmulepi64_si128(a, k, 0x00), 8), a); \
+	a = _mm_clmulepi64_si128(a, k, 0x10);
+
+#define CRC_MSB_BODY(crc_short, vinit) \
+	__m128i vswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15); \
+	__m128i x0, x1, x2, x3; \
+	size_t r = n & 15; \
+	\
+	if (n < 64) return crc_short(s, n, c); \
+	/* the head goes first, leaving whole blocks */ \
+	c = ~crc_short(s, r, c); \
+	s += r; n -= r; \
+	x0 = _mm_xor_si128(CRC_MSB_LOAD(s), vinit); \
+	s += 16; n -= 16; \
+	if (n >= 112) { \
+		x1 = CRC_MSB_LOAD(s); \
+		x2 = CRC_MSB_LOAD(s + 16); \
+		x3 = CRC_MSB_LOAD(s + 32); \
+		s += 48; n -= 48; \
+		do { \
+			CRC_MSB_FOLD(x0, vfold64, CRC_MSB_LOAD(s)) \
+			CRC_MSB_FOLD(x1, vfold64, CRC_MSB_LOAD(s + 16)) \
+			CRC_MSB_FOLD(x2, vfold64, CRC_MSB_LOAD(s + 32)) \
+			CRC_MSB_FOLD(x3, vfold64, CRC_MSB_LOAD(s + 48)) \
+			s += 64; n -= 64; \
+		} while (n >= 64); \
+		CRC_MSB_FOLD(x0, vfold16, x1) \
+		CRC_MSB_FOLD(x0, vfold16, x2) \
+		CRC_MSB_FOLD(x0, vfold16, x3) \
+	} \
+	for (; n; s += 16, n -= 16) \
+		CRC_MSB_FOLD(x0, vfold16, CRC_MSB_LOAD(s)) \
+	/* x0 = H * x^64 + L, CRC = (H * x^64 + L) * x^W mod P */ \
+	x1 = _mm_srli_si128(x0, 8);
+
+uint32_t crc32_msb_clmul(const uint8_t *s, size_t n, uint32_t c) {
+	// P = x^32 + 0x04c11db7
+	__m128i vfold16 = _mm_set_epi64x(0xc5b9cd4c, 0xe8a45605); // x^192, x^128 mod P
+	__m128i vfold64 = _mm_set_epi64x(0x8833794c, 0xe6228b11); // x^576, x^512 mod P
+	__m128i vbarrett = _mm_set_epi64x(0x04c11db7, 0x04d101df481b4e5a); // P, x^96 / P
+	__m128i vmask = _mm_set_epi32(0, 0, 0, -1);
+
+	CRC_MSB_BODY(crc32_msb_clsim, _mm_set_epi32(c, 0, 0, 0))
+	/* H * x^64 mod P = B(B(H)) */
+	CRC_MSB_BARRETT(x1, vbarrett) x1 = _mm_and_si128(x1, vmask);
+	CRC_MSB_BARRETT(x1, vbarrett) x1 = _mm_xor_si128(_mm_and_si128(x1, vmask), x0);
+	CRC_MSB_BARRETT(x1, vbarrett)
+	return ~_mm_cvtsi128_si32(x1);
+}
+
+uint64_t crc64_msb_clmul(const uint8_t *s, size_t n, uint64_t c) {
+	// P = x^64 + 0x42f0e1eba9ea3693
+	__m128i vfold16 = _mm_set_epi64x(0x4eb938a7d257740e, 0x05f5c3c7eb52fab6); // x^192, x^128 mod P
+	__m128i vfold64 = _mm_set_epi64x(0xddf4b6981205b83f, 0x5f6843ca540df020); // x^576, x^512 mod P
+	__m128i vbarrett = _mm_set_epi64x(0x42f0e1eba9ea3693, 0x578d29d06cc4f872); // P, x^128 / P
+	uint64_t r64;
+
+	CRC_MSB_BODY(crc64_msb_clsim, _mm_set_epi64x(c, 0))
+	/* H * x^64 mod P = B(H) */
+	CRC_MSB_BARRETT(x1, vbarrett) x1 = _mm_xor_si128(x1, x0);
+	CRC_MSB_BARRETT(x1, vbarrett)
+	_mm_storel_epi64((__m128i*)&r64, x1);
+	return ~r64;
+}
+
+#undef CRC_MSB_BODY
+#undef CRC_MSB_BARRETT
+#undef CRC_MSB_FOLD
+#undef CRC_MSB_LOAD
+#endif
@@ -0,0 +1,129 @@
+/*
+ * CRC of one large buffer on several threads. Each thread takes a
+ * contiguous stripe (page aligned, so the hardware prefetchers see long
+ * sequential runs), the partial CRCs are merged with crc*_combine, or
+ * multmodp for the other polynomials.
+ * The threads are created per call, which costs tens of microseconds,
+ * so it only pays off for buffers of many MB.
+ *
+ * Requires "crc_combine.h" and the kernels included before.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#ifndef CRC_PARALLEL_MIN
+#define CRC_PARALLEL_MIN (256 << 10)
+#endif
+#define CRC_PARALLEL_MAX 256
+
+typedef struct {
+	const uint8_t *data; size_t length; uint64_t crc;
+	uint32_t (*fn32)(const uint8_t*, size_t, uint32_t);
+	uint64_t (*fn64)(const uint8_t*, size_t, uint64_t);
+} crc_parallel_t;
+
+static void *crc_parallel_thread(void *arg) {
+	crc_parallel_t *t = (crc_parallel_t*)arg;
+	if (t->fn64) t->crc = t->fn64(t->data, t->length, t->crc);
+	else t->crc = t->fn32(t->data, t->length, (uint32_t)t->crc);
+	return NULL;
+}
+
+/*
+ * splits into stripes that start on a page, the first one shorter,
+ * and runs them, the first one on this thread
+ */
+static int crc_parallel_run(crc_parallel_t *t, const uint8_t *data,
+		size_t length, int nthreads) {
+	pthread_t th[CRC_PARALLEL_MAX];
+	size_t stripe = ((length + nthreads - 1) / nthreads + 4095) & -4096;
+	int i, n, ok[CRC_PARALLEL_MAX];
+
+	for (n = 0; length; n++) {
+		size_t k = n == nthreads - 1 ? length : stripe - (n ? 0 : (uintptr_t)data & 4095);
+		t[n].data = data;
+		t[n].length = length < k ? length : k;
+		data += t[n].length; length -= t[n].length;
+		if (n) t[n].crc = 0, t[n].fn32 = t->fn32, t[n].fn64 = t->fn64;
+	}
+	for (i = 1; i < n; i++)
+		ok[i] = !pthread_create(&th[i], NULL, crc_parallel_thread, &t[i]);
+	crc_parallel_thread(t);
+	for (i = 1; i < n; i++)
+		if (ok[i]) pthread_join(th[i], NULL);
+		else crc_parallel_thread(&t[i]);
+	return n;
+}
+
+static int crc_parallel_threads(size_t length, int nthreads) {
+	if ((size_t)nthreads > length / CRC_PARALLEL_MIN)
+		nthreads = length / CRC_PARALLEL_MIN;
+	return nthreads < CRC_PARALLEL_MAX ? nthreads : CRC_PARALLEL_MAX;
+}
+
+/*
+ * p is the reflected polynomial of fn, msb is set for a non-reflected
+ * CRC: its values are reflected around the merge
+ */
+uint32_t crc32_parallel_fn(uint32_t (*fn)(const uint8_t*, size_t, uint32_t),
+		uint32_t p, int msb, const uint8_t *data, size_t length, uint32_t crc,
+		int nthreads) {
+	crc_parallel_t t[CRC_PARALLEL_MAX];
+	uint32_t op = 0, c; int i, n;
+
+	nthreads = crc_parallel_threads(length, nthreads);
+	if (nthreads <= 1) return fn(data, length, crc);
+	t[0].crc = crc; t[0].fn32 = fn; t[0].fn64 = NULL;
+	n = crc_parallel_run(t, data, length, nthreads);
+	for (crc = t[0].crc, i = 1; i < n; i++) {
+		if (i == 1 || t[i].length != t[i - 1].length)
+			op = crc32_x8nmodp(p, t[i].length);
+		c = (uint32_t)t[i].crc;
+		if (msb) crc = crc32_reflect(crc), c = crc32_reflect(c);
+		crc = p == 0xedb88320 ? crc32_combine_op(crc, c, op) : crc32_multmodp(p, op, crc) ^ c;
+		if (msb) crc = crc32_reflect(crc);
+	}
+	return crc;
+}
+
+uint64_t crc64_parallel_fn(uint64_t (*fn)(const uint8_t*, size_t, uint64_t),
+		uint64_t p, int msb, const uint8_t *data, size_t length, uint64_t crc,
+		int nthreads) {
+	crc_parallel_t t[CRC_PARALLEL_MAX];
+	uint64_t op = 0, c; int i, n;
+
+	nthreads = crc_parallel_threads(length, nthreads);
+	if (nthreads <= 1) return fn(data, length, crc);
+	t[0].crc = crc; t[0].fn32 = NULL; t[0].fn64 = fn;
+	n = crc_parallel_run(t, data, length, nthreads);
+	for (crc = t[0].crc, i = 1; i < n; i++) {
+		if (i == 1 || t[i].length != t[i - 1].length)
+			op = crc64_x8nmodp(p, t[i].length);
+		c = t[i].crc;
+		if (msb) crc = crc64_reflect(crc), c = crc64_reflect(c);
+		crc = p == 0xc96c5795d7870f42 ? crc64_combine_op(crc, c, op) : crc64_multmodp(p, op, crc) ^ c;
+		if (msb) crc = crc64_reflect(crc);
+	}
+	return crc;
+}
+
+/* with the fastest kernel available at compile time */
+#if HAVE_VPCLMUL
+#define CRC_PARALLEL_KERNEL(bits) crc##bits##_vpclmul
+#elif HAVE_CLMUL
+#define CRC_PARALLEL_KERNEL(bits) crc##bits##_clmul
+#else
+#define CRC_PARALLEL_KERNEL(bits) crc##bits##_clsim_4x
+#endif
+
+uint32_t crc32_parallel(const uint8_t *data, size_t length, uint32_t crc, int nthreads) {
+	return crc32_parallel_fn(CRC_PARALLEL_KERNEL(32), 0xedb88320, 0, data, length, crc, nthreads);
+}
+
+uint64_t crc64_parallel(const uint8_t *data, size_t length, uint64_t crc, int nthreads) {
+	return crc64_parallel_fn(CRC_PARALLEL_KERNEL(64), 0xc96c5795d7870f42, 0, data, length, crc, nthreads);
+}
+
+#undef CRC_PARALLEL_KERNEL
@@ -0,0 +1,306 @@
+/*
+ * Read-ahead for the -i input: while chunk k is checksummed, the reads of
+ * chunks k+1..k+depth are in flight, so the disk and the CPU work at the
+ * same time and the throughput is the lower of the two, not their sum.
+ *
+ * Uses io_uring with registered page-aligned buffers for regular files
+ * (Linux 5.6+, or 5.1+ when the buffers can be registered, without
+ * liburing), else a reader thread with read().
+ * With CRC_READ_DIRECT the file is read with O_DIRECT, bypassing the page
+ * cache, and the chunk size is rounded up to a multiple of 4KB.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#ifndef WITH_IO_URING
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define WITH_IO_URING 1
+#endif
+#endif
+#endif
+#ifndef WITH_IO_URING
+#define WITH_IO_URING 0
+#endif
+
+#if WITH_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#define CRC_READ_DIRECT 1
+#define CRC_READ_THREAD 2 /* don't use io_uring */
+
+#define CRC_READ_MAX 64 /* buffers, depth + 1 */
+#define CRC_READ_ALIGN 4096
+
+typedef struct {
+	int fd, nbufs, uring, err, direct;
+	size_t chunk, next, released, size;
+	uint8_t *buf[CRC_READ_MAX];
+	size_t len[CRC_READ_MAX];
+	/* reader thread */
+	pthread_t th; pthread_mutex_t mu; pthread_cond_t cv;
+	size_t filled; int stop, eof;
+#if WITH_IO_URING
+	int ring, fixed, inflight;
+	unsigned *sq_tail, *sq_mask, *sq_array, *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes; struct io_uring_cqe *cqes;
+	void *sq_ptr, *cq_ptr; size_t sq_size, cq_size, sqes_size;
+	unsigned char done[CRC_READ_MAX];
+#endif
+} crc_reader_t;
+
+/* comma-separated "direct", "thread" after the depth */
+static int crc_reader_flags(const char *s) {
+	int flags = 0;
+	if (strstr(s, "direct")) flags |= CRC_READ_DIRECT;
+	if (strstr(s, "thread")) flags |= CRC_READ_THREAD;
+	return flags;
+}
+
+static void *crc_reader_thread(void *arg) {
+	crc_reader_t *r = (crc_reader_t*)arg;
+	size_t k, n;
+	ssize_t m;
+	int err = 0, stop;
+
+	for (k = 0;; k++) {
+		uint8_t *b = r->buf[k % r->nbufs];
+		pthread_mutex_lock(&r->mu);
+		/* the slot of chunk k - nbufs must be released */
+		while (k >= r->released + r->nbufs && !r->stop)
+			pthread_cond_wait(&r->cv, &r->mu);
+		stop = r->stop;
+		pthread_mutex_unlock(&r->mu);
+		if (stop) break;
+		for (n = 0; n < r->chunk; n += m) {
+			m = read(r->fd, b + n, r->chunk - n);
+			if (m < 0 && errno == EINTR) { m = 0; continue; }
+			if (m <= 0) { if (m < 0) err = errno; break; }
+		}
+		pthread_mutex_lock(&r->mu);
+		r->len[k % r->nbufs] = n; r->filled = k + 1;
+		if (n < r->chunk) r->eof = 1, r->err = err;
+		pthread_cond_broadcast(&r->cv);
+		pthread_mutex_unlock(&r->mu);
+		if (n < r->chunk) break;
+	}
+	return NULL;
+}
+
+#if WITH_IO_URING
+static int crc_uring_submit(crc_reader_t *r, size_t k, size_t got) {
+	int s = k % r->nbufs;
+	unsigned tail = *r->sq_tail, i = tail & *r->sq_mask;
+	struct io_uring_sqe *sqe = &r->sqes[i];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = r->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+	sqe->fd = r->fd;
+	sqe->addr = (uintptr_t)(r->buf[s] + got);
+	sqe->len = r->chunk - got;
+	sqe->off = k * r->chunk + got;
+	sqe->buf_index = s;
+	sqe->user_data = k;
+	r->sq_array[i] = i;
+	__atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	r->done[s] = 0; r->len[s] = got;
+	if (syscall(__NR_io_uring_enter, r->ring, 1, 0, 0, NULL, 0) != 1) {
+		/* not consumed, without SQPOLL the kernel only reads it on enter */
+		__atomic_store_n(r->sq_tail, tail, __ATOMIC_RELEASE);
+		return 1;
+	}
+	r->inflight++;
+	return 0;
+}
+
+/* the mappings that succeeded, and the ring */
+static void crc_uring_unmap(crc_reader_t *r) {
+	if (r->sq_ptr != MAP_FAILED) munmap(r->sq_ptr, r->sq_size);
+	if (r->cq_ptr != MAP_FAILED) munmap(r->cq_ptr, r->cq_size);
+	if ((void*)r->sqes != MAP_FAILED) munmap(r->sqes, r->sqes_size);
+	close(r->ring);
+}
+
+/* IORING_OP_READ (5.6+), which has IORING_REGISTER_PROBE too */
+static int crc_uring_has_read(crc_reader_t *r) {
+	uint64_t b[(sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op)) / 8];
+	struct io_uring_probe *p = (struct io_uring_probe*)b;
+	memset(b, 0, sizeof(b));
+	if (syscall(__NR_io_uring_register, r->ring, IORING_REGISTER_PROBE, p, 256)) return 0;
+	return p->last_op >= IORING_OP_READ &&
+			(p->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+}
+
+/* waits for at least one completion */
+static int crc_uring_reap(crc_reader_t *r) {
+	unsigned head, tail;
+	if (syscall(__NR_io_uring_enter, r->ring, 0, 1,
+			IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR) return 1;
+	head = *r->cq_head;
+	tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+	for (; head != tail; head++) {
+		struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+		size_t k = cqe->user_data, start, got, end;
+		int s = k % r->nbufs;
+		r->inflight--;
+		r->done[s] = 1;
+		if (cqe->res < 0) { r->err = -cqe->res; continue; }
+		start = r->len[s];
+		got = r->len[s] += cqe->res;
+		end = r->size - k * r->chunk;
+		if (end > r->chunk) end = r->chunk;
+		if (!cqe->res || got >= end) continue;
+		/* a short read in the middle of the file, O_DIRECT goes on from a block */
+		if (r->direct) got &= -(size_t)CRC_READ_ALIGN;
+		if (got <= start || crc_uring_submit(r, k, got)) r->err = EIO;
+	}
+	__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static int crc_uring_open(crc_reader_t *r, int depth) {
+	struct io_uring_params p;
+	struct iovec iov[CRC_READ_MAX];
+	size_t k;
+	int i;
+
+	memset(&p, 0, sizeof(p));
+	r->ring = syscall(__NR_io_uring_setup, depth + 1, &p);
+	if (r->ring < 0) return 1;
+	r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	r->sq_ptr = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, r->ring, IORING_OFF_SQ_RING);
+	r->cq_ptr = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, r->ring, IORING_OFF_CQ_RING);
+	r->sqes = (struct io_uring_sqe*)mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, r->ring, IORING_OFF_SQES);
+	if (r->sq_ptr == MAP_FAILED || r->cq_ptr == MAP_FAILED ||
+			(void*)r->sqes == MAP_FAILED) {
+		crc_uring_unmap(r);
+		return 1;
+	}
+	r->sq_tail = (unsigned*)((char*)r->sq_ptr + p.sq_off.tail);
+	r->sq_mask = (unsigned*)((char*)r->sq_ptr + p.sq_off.ring_mask);
+	r->sq_array = (unsigned*)((char*)r->sq_ptr + p.sq_off.array);
+	r->cq_head = (unsigned*)((char*)r->cq_ptr + p.cq_off.head);
+	r->cq_tail = (unsigned*)((char*)r->cq_ptr + p.cq_off.tail);
+	r->cq_mask = (unsigned*)((char*)r->cq_ptr + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe*)((char*)r->cq_ptr + p.cq_off.cqes);
+
+	/* pinned once, not per read; plain reads if over RLIMIT_MEMLOCK */
+	for (i = 0; i < r->nbufs; i++)
+		iov[i].iov_base = r->buf[i], iov[i].iov_len = r->chunk;
+	r->fixed = !syscall(__NR_io_uring_register,
+			r->ring, IORING_REGISTER_BUFFERS, iov, r->nbufs);
+	/* before 5.6 only IORING_OP_READ_FIXED, else the reader thread */
+	if (!r->fixed && !crc_uring_has_read(r)) {
+		crc_uring_unmap(r);
+		return 1;
+	}
+
+	r->uring = 1;
+	for (k = 0; k < (size_t)r->nbufs && k * r->chunk < r->size; k++)
+		if (crc_uring_submit(r, k, 0)) return 1;
+	return 0;
+}
+#endif
+
+/* returns non-zero on failure */
+static int crc_reader_open(crc_reader_t *r, int fd, size_t chunk, int depth, int flags) {
+	struct stat st;
+	int i;
+
+	memset(r, 0, sizeof(*r));
+	if (depth < 1 || depth >= CRC_READ_MAX) return 1;
+	if (flags & CRC_READ_DIRECT) {
+#ifdef O_DIRECT
+		if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_DIRECT)) return 1;
+		chunk = (chunk + CRC_READ_ALIGN - 1) & -CRC_READ_ALIGN;
+		r->direct = 1;
+#else
+		return 1;
+#endif
+	}
+	r->fd = fd; r->chunk = chunk; r->nbufs = depth + 1;
+	for (i = 0; i < r->nbufs; i++)
+		if (posix_memalign((void**)&r->buf[i], CRC_READ_ALIGN, chunk)) return 1;
+
+#if WITH_IO_URING
+	if (!(flags & CRC_READ_THREAD) && !fstat(fd, &st) && S_ISREG(st.st_mode)) {
+		r->size = st.st_size;
+		if (!crc_uring_open(r, depth)) return 0;
+		if (r->uring) return 1;
+	}
+#else
+	(void)st;
+#endif
+	pthread_mutex_init(&r->mu, NULL);
+	pthread_cond_init(&r->cv, NULL);
+	return pthread_create(&r->th, NULL, crc_reader_thread, r) != 0;
+}
+
+/* the next chunk in file order, NULL at the end; releases the previous one */
+static const uint8_t *crc_reader_next(crc_reader_t *r, size_t *n) {
+	int s = r->next % r->nbufs;
+#if WITH_IO_URING
+	if (r->uring) {
+		size_t k = r->released;
+		if (k < r->next) {
+			r->released++;
+			k += r->nbufs;
+			if (k * r->chunk < r->size && !r->err && crc_uring_submit(r, k, 0)) r->err = EIO;
+		}
+		if (r->next * r->chunk >= r->size || r->err) return NULL;
+		while (!r->done[s])
+			if (crc_uring_reap(r)) { r->err = EIO; return NULL; }
+		if (r->err || !(*n = r->len[s])) return NULL;
+		r->next++;
+		return r->buf[s];
+	}
+#endif
+	pthread_mutex_lock(&r->mu);
+	if (r->released < r->next) {
+		r->released++;
+		pthread_cond_broadcast(&r->cv);
+	}
+	while (r->filled <= r->next && !r->eof)
+		pthread_cond_wait(&r->cv, &r->mu);
+	*n = r->next < r->filled ? r->len[s] : 0;
+	pthread_mutex_unlock(&r->mu);
+	if (!*n) return NULL;
+	r->next++;
+	return r->buf[s];
+}
+
+static void crc_reader_close(crc_reader_t *r) {
+	int i;
+#if WITH_IO_URING
+	if (r->uring) {
+		while (r->inflight && !crc_uring_reap(r));
+		crc_uring_unmap(r);
+	} else
+#endif
+	if (r->nbufs) {
+		pthread_mutex_lock(&r->mu);
+		r->stop = 1;
+		pthread_cond_broadcast(&r->cv);
+		pthread_mutex_unlock(&r->mu);
+		pthread_join(r->th, NULL);
+		pthread_mutex_destroy(&r->mu);
+		pthread_cond_destroy(&r->cv);
+	}
+	for (i = 0; i < r->nbufs; i++) free(r->buf[i]);
+}
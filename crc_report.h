@@ -0,0 +1,253 @@
+/*
+ * Machine-readable results (--format=json or csv) and the comparison of
+ * two such files (-c old new). JSON is one object per line; CSV has a
+ * header line. Strings never contain quotes or commas, so both are
+ * parsed here with a few lines of code.
+ *
+ * The comparison pairs records by variant, polynomial, length and
+ * alignment. A difference counts when it is over the gate (-g, 2% by
+ * default) and over twice the combined stddev of the two records. A
+ * record of one run, or with a zero stddev, has no spread estimate, so
+ * its pairs are never counted. Any slower one makes the exit status 4,
+ * else any old record without a new one 5.
+ *
+ * Requires "crc_stats.h".
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { CRC_FMT_TEXT, CRC_FMT_JSON, CRC_FMT_CSV };
+
+typedef struct {
+	const char *variant, *poly, *unit;
+	char crc[17];
+	size_t len; int align, runs;
+	/* unit per byte; insn < 0, ghz = 0 and gbps = 0 if unknown */
+	double ms, cpb, cpb_min, cpb_p90, stddev, insn, ghz, gbps;
+} crc_record_t;
+
+#if defined(__clang__)
+#define CRC_COMPILER "clang " __clang_version__
+#elif defined(__GNUC__)
+#define CRC_COMPILER "gcc " __VERSION__
+#else
+#define CRC_COMPILER "unknown"
+#endif
+
+/* -DCRC_CFLAGS="\"...\"" from the build, else the target features */
+#ifndef CRC_CFLAGS
+#define CRC_CFLAGS "" CRC_FLAG_O CRC_FLAG_SSE42 CRC_FLAG_PCLMUL CRC_FLAG_AVX2 \
+	CRC_FLAG_AVX512 CRC_FLAG_VPCLMUL CRC_FLAG_ARMCRC CRC_FLAG_ARMPMULL
+#ifdef __OPTIMIZE__
+#define CRC_FLAG_O "-O "
+#else
+#define CRC_FLAG_O "-O0 "
+#endif
+#ifdef __SSE4_2__
+#define CRC_FLAG_SSE42 "sse4.2 "
+#else
+#define CRC_FLAG_SSE42
+#endif
+#ifdef __PCLMUL__
+#define CRC_FLAG_PCLMUL "pclmul "
+#else
+#define CRC_FLAG_PCLMUL
+#endif
+#ifdef __AVX2__
+#define CRC_FLAG_AVX2 "avx2 "
+#else
+#define CRC_FLAG_AVX2
+#endif
+#ifdef __AVX512F__
+#define CRC_FLAG_AVX512 "avx512 "
+#else
+#define CRC_FLAG_AVX512
+#endif
+#ifdef __VPCLMULQDQ__
+#define CRC_FLAG_VPCLMUL "vpclmul "
+#else
+#define CRC_FLAG_VPCLMUL
+#endif
+#ifdef __ARM_FEATURE_CRC32
+#define CRC_FLAG_ARMCRC "crc "
+#else
+#define CRC_FLAG_ARMCRC
+#endif
+#ifdef __ARM_FEATURE_CRYPTO
+#define CRC_FLAG_ARMPMULL "crypto "
+#else
+#define CRC_FLAG_ARMPMULL
+#endif
+#endif
+
+static int crc_format = CRC_FMT_TEXT;
+
+/* --format=... */
+static int crc_format_parse(const char *s) {
+	if (!strcmp(s, "json")) return CRC_FMT_JSON;
+	if (!strcmp(s, "csv")) return CRC_FMT_CSV;
+	if (!strcmp(s, "text")) return CRC_FMT_TEXT;
+	return -1;
+}
+
+/* without quotes, commas and trailing spaces */
+static void crc_report_str(const char *s) {
+	for (; *s; s++)
+		if (*s != ' ' || s[1]) putchar(*s == '"' || *s == ',' ? ' ' : *s);
+}
+
+static void crc_report_header(void) {
+	if (crc_format == CRC_FMT_CSV)
+		printf("variant,poly,crc,len,align,unit,ms,cpb,cpb_min,cpb_p90,stddev,runs,insn,ghz,gbps,compiler,flags\n");
+}
+
+static void crc_report(const crc_record_t *r) {
+	int json = crc_format == CRC_FMT_JSON;
+#define STR(key, val) \
+	printf(json ? ",\"" key "\":\"" : ","); \
+	crc_report_str(val); if (json) putchar('"');
+#define NUM(key, fmt, val) \
+	printf(json ? ",\"" key "\":" fmt : "," fmt, val);
+
+	printf(json ? "{\"variant\":\"" : "");
+	crc_report_str(r->variant); if (json) putchar('"');
+	STR("poly", r->poly)
+	STR("crc", r->crc)
+	NUM("len", "%lu", (unsigned long)r->len)
+	NUM("align", "%i", r->align)
+	STR("unit", r->unit)
+	NUM("ms", "%.4f", r->ms)
+	NUM("cpb", "%.5f", r->cpb)
+	NUM("cpb_min", "%.5f", r->cpb_min)
+	NUM("cpb_p90", "%.5f", r->cpb_p90)
+	NUM("stddev", "%.3f", r->stddev)
+	NUM("runs", "%i", r->runs)
+	if (r->insn >= 0) { NUM("insn", "%.4f", r->insn) }
+	else printf(json ? ",\"insn\":null" : ",");
+	NUM("ghz", "%.3f", r->ghz)
+	NUM("gbps", "%.3f", r->gbps)
+	STR("compiler", CRC_COMPILER)
+	STR("flags", CRC_CFLAGS)
+	printf(json ? "}\n" : "\n");
+#undef STR
+#undef NUM
+}
+
+typedef struct {
+	char key[260];
+	double cpb, stddev; int runs;
+} crc_result_t;
+
+/* the value of key in a JSON line, or in a CSV line with its header */
+static int crc_report_field(const char *line, const char *header,
+		const char *key, char *out, size_t size) {
+	const char *p = line, *e;
+	size_t n = strlen(key);
+	if (*line == '{') {
+		for (; (p = strstr(p, key)); p += n)
+			if (p > line && p[-1] == '"' && p[n] == '"' && p[n + 1] == ':') break;
+		if (!p) return 1;
+		p += n + 2;
+		if (*p == '"') p++;
+		e = p + strcspn(p, "\",}");
+	} else {
+		const char *h = header;
+		while (strncmp(h, key, n) || !strchr(",\n", h[n])) {
+			h = strchr(h, ','); p = strchr(p, ',');
+			if (!h || !p) return 1;
+			h++; p++;
+		}
+		e = p + strcspn(p, ",\n");
+	}
+	n = e - p < (ptrdiff_t)size ? (size_t)(e - p) : size - 1;
+	memcpy(out, p, n); out[n] = 0;
+	return 0;
+}
+
+/* reads the records of a file, returns their count or -1 */
+static int crc_report_load(const char *name, crc_result_t **res, char *build, size_t size) {
+	FILE *f = fopen(name, "r");
+	char line[1024], header[1024] = "", v[4][64], cpb[32], sd[32], runs[32];
+	char cc[64], flags[128];
+	int n = 0, cap = 0;
+
+	*res = NULL; *build = 0;
+	if (!f) return -1;
+	while (fgets(line, sizeof(line), f)) {
+		crc_result_t *r;
+		if (*line != '{' && !*header) { strcpy(header, line); continue; }
+		if (crc_report_field(line, header, "variant", v[0], 64) ||
+				crc_report_field(line, header, "poly", v[1], 64) ||
+				crc_report_field(line, header, "len", v[2], 64) ||
+				crc_report_field(line, header, "align", v[3], 64) ||
+				crc_report_field(line, header, "cpb", cpb, 32)) continue;
+		if (crc_report_field(line, header, "stddev", sd, 32)) strcpy(sd, "0");
+		if (crc_report_field(line, header, "runs", runs, 32)) strcpy(runs, "1");
+		if (n == cap) {
+			cap = cap ? cap * 2 : 64;
+			if (!(r = (crc_result_t*)realloc(*res, cap * sizeof(*r)))) break;
+			*res = r;
+		}
+		/* the compiler and flags of the first record */
+		if (!n && !crc_report_field(line, header, "compiler", cc, sizeof(cc)) &&
+				!crc_report_field(line, header, "flags", flags, sizeof(flags)))
+			snprintf(build, size, "%s, %s", cc, flags);
+		r = &(*res)[n++];
+		snprintf(r->key, sizeof(r->key), "%s %s %s %s", v[0], v[1], v[2], v[3]);
+		r->cpb = atof(cpb); r->stddev = atof(sd); r->runs = atoi(runs);
+	}
+	fclose(f);
+	return n;
+}
+
+/* prints the differences, or every pair with verbose > 1 */
+static int crc_compare(const char *name0, const char *name1, double gate, int verbose) {
+	crc_result_t *a, *b;
+	char build0[200], build1[200];
+	int na = crc_report_load(name0, &a, build0, sizeof(build0));
+	int nb = crc_report_load(name1, &b, build1, sizeof(build1));
+	int i, j, slower = 0, matched = 0, missing = 0, nospread = 0;
+
+	if (na < 0 || nb < 0) {
+		printf("!!! can't read %s\n", na < 0 ? name0 : name1);
+		return 1;
+	}
+	printf("old: %s\nnew: %s\n", build0, build1);
+	printf("%-48s %9s %9s %8s\n", "variant poly len align", "old", "new", "speedup");
+	for (i = 0; i < na; i++)
+	for (j = 0; j < nb; j++) {
+		double d, noise;
+		const char *flag = "";
+		if (strcmp(a[i].key, b[j].key)) continue;
+		matched++;
+		if (!a[i].cpb || !b[j].cpb) break;
+		/* % slower, stddev is in % too */
+		d = 100 * (b[j].cpb / a[i].cpb - 1);
+		noise = 2 * crc_stats_sqrt(a[i].stddev * a[i].stddev + b[j].stddev * b[j].stddev);
+		if (a[i].runs < 2 || b[j].runs < 2 || !a[i].stddev || !b[j].stddev) {
+			if (d > gate || -d > gate) flag = "no stddev", nospread++;
+		} else if (d > gate && d > noise) flag = "SLOWER", slower++;
+		else if (-d > gate && -d > noise) flag = "faster";
+		else if (d > gate || -d > gate) flag = "noise";
+		if (*flag || verbose > 1)
+			printf("%-48s %9.4f %9.4f %7.3fx %s\n", a[i].key, a[i].cpb, b[j].cpb,
+					a[i].cpb / b[j].cpb, flag);
+		break;
+	}
+	/* the old records not in the new file */
+	for (i = 0; i < na; i++) {
+		for (j = 0; j < nb && strcmp(a[i].key, b[j].key); j++);
+		if (j < nb) continue;
+		printf("%-48s %9.4f %9s %8s MISSING\n", a[i].key, a[i].cpb, "-", "");
+		missing++;
+	}
+	printf("%i matched, %i slower by over %.1f%%, %i missing\n",
+			matched, slower, gate, missing);
+	if (nospread)
+		printf("!!! %i pairs over the gate without a stddev (single runs or zero)\n", nospread);
+	free(a); free(b);
+	return slower ? 4 : missing ? 5 : 0;
+}
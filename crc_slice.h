@@ -24,6 +24,15 @@ void crc32_slice4_init(void) {
 		}
 }
 
+/* one 4-byte word on the raw state, for crc_interleave.h */
+static inline uint32_t crc32_slice4_step(uint32_t c, uint32_t t) {
+	c ^= t;
+	return crc32_table4[3][c & 0xff] ^
+		crc32_table4[2][c >> 8 & 0xff] ^
+		crc32_table4[1][c >> 16 & 0xff] ^
+		crc32_table4[0][c >> 24];
+}
+
 uint32_t crc32_slice4(const uint8_t *s, size_t n, uint32_t c) {
 	c = ~c;
 
@@ -74,6 +83,14 @@ void crc64_slice4_init(void) {
 		}
 }
 
+static inline uint64_t crc64_slice4_step(uint64_t c, uint32_t t) {
+	uint32_t x = c ^ t;
+	return crc64_table4[3][x & 0xff] ^
+		crc64_table4[2][x >> 8 & 0xff] ^
+		crc64_table4[1][x >> 16 & 0xff] ^
+		crc64_table4[0][x >> 24] ^ c >> 32;
+}
+
 uint64_t crc64_slice4(const uint8_t *s, size_t n, uint64_t c) {
 	c = ~c;
 
@@ -0,0 +1,51 @@
+/*
+ * CRC32 (PKZIP) and CRC64 (XZ) using LUT, slice by 8 and 16. The tables
+ * are static const from slice_gen.c, so no init is needed.
+ * 16*256*4 = 16KB for crc32, 16*256*8 = 32KB for crc64;
+ * slice by 8 only uses the first half.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "crc_slice_tables.h"
+
+/* 8 bytes of x, table j is for the byte followed by j zero bytes */
+#define SLICE8(T, x, j) ( \
+	T[j + 7][x & 0xff] ^ T[j + 6][x >> 8 & 0xff] ^ \
+	T[j + 5][x >> 16 & 0xff] ^ T[j + 4][x >> 24 & 0xff] ^ \
+	T[j + 3][x >> 32 & 0xff] ^ T[j + 2][x >> 40 & 0xff] ^ \
+	T[j + 1][x >> 48 & 0xff] ^ T[j][x >> 56])
+
+#define SLICE_BODY(T, step) \
+	c = ~c; \
+	for (; n && (uintptr_t)s & 7; n--) \
+		c = T[0][*s++ ^ (c & 0xff)] ^ c >> 8; \
+	for (; n >= step; n -= step, s += step) { \
+		const uint64_t *a = (const uint64_t*)s; \
+		uint64_t x = a[0] ^ c; \
+		if (step == 8) c = SLICE8(T, x, 0); \
+		else c = SLICE8(T, x, 8) ^ SLICE8(T, a[1], 0); \
+	} \
+	for (; n; n--) \
+		c = T[0][*s++ ^ (c & 0xff)] ^ c >> 8; \
+	return ~c;
+
+uint32_t crc32_slice8(const uint8_t *s, size_t n, uint32_t c) {
+	SLICE_BODY(crc32_table16, 8)
+}
+
+uint32_t crc32_slice16(const uint8_t *s, size_t n, uint32_t c) {
+	SLICE_BODY(crc32_table16, 16)
+}
+
+uint64_t crc64_slice8(const uint8_t *s, size_t n, uint64_t c) {
+	SLICE_BODY(crc64_table16, 8)
+}
+
+uint64_t crc64_slice16(const uint8_t *s, size_t n, uint64_t c) {
+	SLICE_BODY(crc64_table16, 16)
+}
+
+#undef SLICE_BODY
+#undef SLICE8
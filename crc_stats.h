@@ -0,0 +1,74 @@
+/*
+ * Summary of repeated runs (-r): min, median, p90 and stddev of the
+ * per-run cycles/byte (or ns/byte), after dropping the samples further
+ * than CRC_STATS_MADS scaled median absolute deviations from the median.
+ * Above CRC_STATS_NOISE relative stddev the runs can't rank two kernels
+ * that differ by about 1%.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CRC_STATS_MADS 3.0
+#define CRC_STATS_NOISE 0.01
+
+typedef struct {
+	int n, outliers;
+	double min, median, p90, mean, stddev;
+} crc_stats_t;
+
+static double crc_stats_abs(double x) { return x < 0 ? -x : x; }
+
+/* without libm */
+static double crc_stats_sqrt(double x) {
+	double r = x > 1 ? x : 1;
+	int i;
+	if (x <= 0) return 0;
+	for (i = 0; i < 64; i++) r = (r + x / r) / 2;
+	return r;
+}
+
+static int crc_stats_cmp(const void *a, const void *b) {
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+/* q-th quantile of sorted x */
+static double crc_stats_quantile(const double *x, int n, double q) {
+	double i = q * (n - 1);
+	int k = (int)i;
+	return k + 1 < n ? x[k] + (x[k + 1] - x[k]) * (i - k) : x[k];
+}
+
+/* sorts x in place */
+static void crc_stats_calc(crc_stats_t *st, double *x, int n) {
+	double *d = (double*)malloc(n * sizeof(*d)), med, mad, s = 0, s2 = 0;
+	int i, k;
+
+	qsort(x, n, sizeof(*x), crc_stats_cmp);
+	med = crc_stats_quantile(x, n, 0.5);
+	for (i = 0; i < n; i++) d[i] = crc_stats_abs(x[i] - med);
+	qsort(d, n, sizeof(*d), crc_stats_cmp);
+	/* 1.4826 * MAD estimates the stddev of normal samples */
+	mad = 1.4826 * crc_stats_quantile(d, n, 0.5);
+	for (i = k = 0; i < n; i++)
+		if (!mad || crc_stats_abs(x[i] - med) <= CRC_STATS_MADS * mad) x[k++] = x[i];
+	free(d);
+
+	st->n = k; st->outliers = n - k;
+	for (i = 0; i < k; i++) s += x[i], s2 += x[i] * x[i];
+	st->min = x[0];
+	st->median = crc_stats_quantile(x, k, 0.5);
+	st->p90 = crc_stats_quantile(x, k, 0.9);
+	st->mean = s / k;
+	st->stddev = k > 1 ? crc_stats_sqrt((s2 - s * s / k) / (k - 1)) : 0;
+}
+
+static void crc_stats_print(const crc_stats_t *st, const char *unit) {
+	printf("%s: min %.4f, median %.4f, p90 %.4f, stddev %.2f%% (%i runs, %i outliers)\n",
+			unit, st->min, st->median, st->p90,
+			100 * st->stddev / st->mean, st->n, st->outliers);
+	if (st->stddev > CRC_STATS_NOISE * st->mean)
+		printf("!!! stddev over %.0f%%, too noisy to rank kernels this close\n",
+				100 * CRC_STATS_NOISE);
+}
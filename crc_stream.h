@@ -0,0 +1,98 @@
+/*
+ * Streaming CRC over fragments: init/update/final around any kernel.
+ * Fragments are gathered in a carry buffer, so the kernel only sees
+ * spans of at least CRC_STREAM_BLOCK bytes from the 64-byte aligned
+ * buffer, or of whole blocks straight from the input when an update is
+ * long enough, and does its head/tail work once per block instead of
+ * once per fragment. The input spans are 64-byte aligned too: up to 63
+ * more bytes go through the buffer before them.
+ * The rest is only checksummed in final, which leaves the state as is,
+ * so more updates can follow.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__AVX512BW__) && defined(__AVX512VL__)
+#include <immintrin.h>
+#endif
+
+#define CRC_STREAM_BLOCK 256
+
+#ifdef __GNUC__
+#define CRC_STREAM_ALIGN __attribute__((aligned(64)))
+#else
+#define CRC_STREAM_ALIGN
+#endif
+
+/*
+ * memcpy without a call for fragments of up to 16 bytes, with AVX-512
+ * a masked load and store, so random lengths don't mispredict
+ */
+static inline void crc_stream_copy(uint8_t *d, const uint8_t *s, size_t n) {
+#if defined(__AVX512BW__) && defined(__AVX512VL__)
+	if (n <= 16) {
+		__mmask16 m = (__mmask16)((1u << n) - 1);
+		_mm_mask_storeu_epi8(d, m, _mm_maskz_loadu_epi8(m, s));
+		return;
+	}
+	memcpy(d, s, n);
+#else
+	if (n >= 8 && n <= 16) {
+		memcpy(d, s, 8);
+		memcpy(d + n - 8, s + n - 8, 8);
+	} else if (n >= 4 && n < 8) {
+		memcpy(d, s, 4);
+		memcpy(d + n - 4, s + n - 4, 4);
+	} else if (n < 4) {
+		if (n) d[0] = s[0];
+		if (n > 1) d[1] = s[1];
+		if (n > 2) d[2] = s[2];
+	} else memcpy(d, s, n);
+#endif
+}
+
+#define CRC_STREAM_DEF(bits) \
+typedef struct { \
+	uint8_t buf[CRC_STREAM_BLOCK + 64] CRC_STREAM_ALIGN; \
+	size_t fill; \
+	uint##bits##_t crc; \
+	uint##bits##_t (*fn)(const uint8_t*, size_t, uint##bits##_t); \
+} crc##bits##_ctx_t; \
+\
+static inline void crc##bits##_ctx_init(crc##bits##_ctx_t *c, \
+		uint##bits##_t (*fn)(const uint8_t*, size_t, uint##bits##_t), uint##bits##_t crc) { \
+	c->fill = 0; c->crc = crc; c->fn = fn; \
+} \
+\
+static inline void crc##bits##_ctx_update(crc##bits##_ctx_t *c, const void *s, size_t n) { \
+	const uint8_t *p = (const uint8_t*)s; \
+	size_t k, m; \
+	while (c->fill + n >= CRC_STREAM_BLOCK) { \
+		if (!c->fill && !((uintptr_t)p & 63)) { \
+			k = n / CRC_STREAM_BLOCK * CRC_STREAM_BLOCK; \
+			c->crc = c->fn(p, k, c->crc); \
+			p += k; n -= k; \
+			break; \
+		} \
+		/* a block from the buffer, with the bytes up to the alignment \
+		   of the rest when whole blocks follow */ \
+		k = CRC_STREAM_BLOCK - c->fill; \
+		m = k + (-(uintptr_t)(p + k) & 63); \
+		if (m + CRC_STREAM_BLOCK <= n) k = m; \
+		memcpy(c->buf + c->fill, p, k); \
+		c->crc = c->fn(c->buf, c->fill + k, c->crc); \
+		c->fill = 0; p += k; n -= k; \
+	} \
+	crc_stream_copy(c->buf + c->fill, p, n); \
+	c->fill += n; \
+} \
+\
+static inline uint##bits##_t crc##bits##_ctx_final(const crc##bits##_ctx_t *c) { \
+	return c->fn(c->buf, c->fill, c->crc); \
+}
+
+CRC_STREAM_DEF(32)
+CRC_STREAM_DEF(64)
+
+#undef CRC_STREAM_DEF
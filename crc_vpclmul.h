@@ -0,0 +1,143 @@
+/*
+ * CRC32 (PKZIP) and CRC64 (XZ) using VPCLMULQDQ, folding 512-bit lanes
+ * with AVX-512 or 256-bit lanes with AVX2.
+ *
+ * The input is padded with leading zeros to a whole number of vectors,
+ * so there is no tail to handle. Short inputs go to crc32/64_clmul.
+ * Requires "crc_clmul.h" for the final reduction.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VL__)
+
+/* x = x * k ^ y, both 128-bit lanes, using one ternary logic op */
+#define FOLDV(x, k, y) \
+	x = _mm512_ternarylogic_epi64(_mm512_clmulepi64_epi128(x, k, 0x00), \
+			_mm512_clmulepi64_epi128(x, k, 0x11), y, 0x96);
+
+#define CRC_VPCLMUL_BODY(init) \
+	const uint8_t *end = data + length; \
+	unsigned skip = -length & 63, q = skip >> 3; \
+	__m128i cnt = _mm_cvtsi32_si128((skip & 7) * 8); \
+	__m128i cnt2 = _mm_cvtsi32_si128(64 - (skip & 7) * 8); \
+	__m512i vinit = _mm512_set1_epi64(init); \
+	__m512i vfold256 = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)k)); \
+	__m512i vfold64 = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)k + 2)); \
+	__m512i vfoldlane = _mm512_maskz_loadu_epi64(0x3f, k + 6); \
+	__m512i x0, x1, x2, x3; \
+	__m256i y; \
+	\
+	/* the init value is placed at the first data byte, may cross into x1 */ \
+	x0 = _mm512_maskz_loadu_epi8(~(uint64_t)0 << skip, data - skip); \
+	x0 = _mm512_ternarylogic_epi64(x0, \
+			_mm512_maskz_sll_epi64((__mmask8)(1 << q), vinit, cnt), \
+			_mm512_maskz_srl_epi64((__mmask8)(2 << q), vinit, cnt2), 0x96); \
+	data += 64 - skip; \
+	x1 = _mm512_xor_si512(_mm512_loadu_si512(data), \
+			_mm512_maskz_srl_epi64((2 << q) >> 8, vinit, cnt2)); \
+	x2 = _mm512_loadu_si512(data + 64); \
+	x3 = _mm512_loadu_si512(data + 128); \
+	data += 192; \
+	for (; end - data >= 256; data += 256) { \
+		FOLDV(x0, vfold256, _mm512_loadu_si512(data)) \
+		FOLDV(x1, vfold256, _mm512_loadu_si512(data + 64)) \
+		FOLDV(x2, vfold256, _mm512_loadu_si512(data + 128)) \
+		FOLDV(x3, vfold256, _mm512_loadu_si512(data + 192)) \
+	} \
+	FOLDV(x0, vfold64, x1) \
+	FOLDV(x0, vfold64, x2) \
+	FOLDV(x0, vfold64, x3) \
+	for (; data < end; data += 64) \
+		FOLDV(x0, vfold64, _mm512_loadu_si512(data)) \
+	/* fold the lanes by 48, 32 and 16 bytes into the last one */ \
+	FOLDV(x0, vfoldlane, _mm512_maskz_mov_epi64(0xc0, x0)) \
+	y = _mm256_xor_si256(_mm512_castsi512_si256(x0), \
+			_mm512_extracti64x4_epi64(x0, 1)); \
+	v = _mm_xor_si128(_mm256_castsi256_si128(y), \
+			_mm256_extracti128_si256(y, 1));
+
+#else
+
+#define FOLDV(x, k, y) \
+	x = _mm256_xor_si256(_mm256_xor_si256(_mm256_clmulepi64_epi128(x, k, 0x00), \
+			_mm256_clmulepi64_epi128(x, k, 0x11)), y);
+
+#define CRC_VPCLMUL_BODY(init) \
+	const uint8_t *end = data + length; \
+	unsigned skip = -length & 31; \
+	uint8_t buf[64] = { 0 }; \
+	uint64_t w; \
+	__m256i vfold128 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)k + 1)); \
+	__m256i vfold32 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)k + 4)); \
+	__m128i vfold16 = _mm_loadu_si128((const __m128i*)k + 5); \
+	__m256i x0, x1, x2, x3; \
+	\
+	/* no byte masked loads, the head goes through the buffer */ \
+	memcpy(buf + skip, data, 64 - skip); \
+	memcpy(&w, buf + skip, 8); w ^= init; memcpy(buf + skip, &w, 8); \
+	x0 = _mm256_loadu_si256((const __m256i*)buf); \
+	x1 = _mm256_loadu_si256((const __m256i*)buf + 1); \
+	data += 64 - skip; \
+	x2 = _mm256_loadu_si256((const __m256i*)data); \
+	x3 = _mm256_loadu_si256((const __m256i*)data + 1); \
+	data += 64; \
+	for (; end - data >= 128; data += 128) { \
+		FOLDV(x0, vfold128, _mm256_loadu_si256((const __m256i*)data)) \
+		FOLDV(x1, vfold128, _mm256_loadu_si256((const __m256i*)data + 1)) \
+		FOLDV(x2, vfold128, _mm256_loadu_si256((const __m256i*)data + 2)) \
+		FOLDV(x3, vfold128, _mm256_loadu_si256((const __m256i*)data + 3)) \
+	} \
+	FOLDV(x0, vfold32, x1) \
+	FOLDV(x0, vfold32, x2) \
+	FOLDV(x0, vfold32, x3) \
+	for (; data < end; data += 32) \
+		FOLDV(x0, vfold32, _mm256_loadu_si256((const __m256i*)data)) \
+	v = _mm256_castsi256_si128(x0); \
+	v = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(v, vfold16, 0x00), \
+			_mm_clmulepi64_si128(v, vfold16, 0x11)), \
+			_mm256_extracti128_si256(x0, 1));
+
+#endif
+
+/* fold constants (lo, hi) by 256, 128, 64, 48, 32, 16 bytes */
+
+uint32_t crc32_vpclmul(const uint8_t *data, size_t length, uint32_t crc) {
+	// uint32_t p = 0xedb88320;
+	static const uint64_t k[12] = {
+		0x11542778a, 0x1322d1430, // calc_hi(p, p, 2048) << 1, 2048 - 64
+		0x1e88ef372, 0x14a7fe880, // 1024
+		0x154442bd4, 0x1c6e41596, // 512
+		0x03db1ecdc, 0x174359406, // 384
+		0x0f1da05aa, 0x15a546366, // 256
+		0x1751997d0, 0x0ccaa009e  // 128
+	};
+	__m128i v;
+	/* before any 256/512-bit op, else the short path runs much slower */
+	if (length < 256) return crc32_clmul(data, length, crc);
+	CRC_VPCLMUL_BODY((uint32_t)~crc)
+	return crc32_clmul_reduce(v, _mm_srli_si128(v, 8));
+}
+
+uint64_t crc64_vpclmul(const uint8_t *data, size_t length, uint64_t crc) {
+	// uint64_t p = 0xc96c5795d7870f42;
+	static const uint64_t k[12] = {
+		0x8260adf2381ad81c, 0xf31fd9271e228b79, // calc_hi(p, 1, 2048), 2048 - 64
+		0x8757d71d4fcc1000, 0xd7d86b2af73de740, // 1024
+		0x6ae3efbb9dd441f3, 0x081f6054a7842df4, // 512
+		0xb5ea1af9c013aca4, 0x69a35d91c3730254, // 384
+		0x60095b008a9efa44, 0x3be653a30fe1af51, // 256
+		0xe05dd497ca393ae4, 0xdabe95afc7875f40  // 128
+	};
+	__m128i v;
+	/* before any 256/512-bit op, else the short path runs much slower */
+	if (length < 256) return crc64_clmul(data, length, crc);
+	CRC_VPCLMUL_BODY(~crc)
+	return crc64_clmul_reduce(v, _mm_srli_si128(v, 8));
+}
+
+#undef CRC_VPCLMUL_BODY
+#undef FOLDV
@@ -0,0 +1,15 @@
+/*
+ * crc32/64_vpclmul on 256-bit vectors for the runtime dispatch.
+ * cc -O3 -mavx2 -mpclmul -mvpclmulqdq -c crc_x86_avx2.c
+ */
+
+#if !defined(__AVX2__) || !defined(__PCLMUL__) || !defined(__VPCLMULQDQ__)
+#error "build with -mavx2 -mpclmul -mvpclmulqdq"
+#endif
+
+#define crc32_clmul crc32_clmul_avx2
+#define crc64_clmul crc64_clmul_avx2
+#define crc32_vpclmul crc32_vpclmul_avx2
+#define crc64_vpclmul crc64_vpclmul_avx2
+#include "crc_clmul.h"
+#include "crc_vpclmul.h"
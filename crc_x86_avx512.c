@@ -0,0 +1,16 @@
+/*
+ * crc32/64_vpclmul on 512-bit vectors for the runtime dispatch.
+ * cc -O3 -mavx512bw -mavx512vl -mpclmul -mvpclmulqdq -c crc_x86_avx512.c
+ */
+
+#if !defined(__AVX512BW__) || !defined(__AVX512VL__) || \
+		!defined(__PCLMUL__) || !defined(__VPCLMULQDQ__)
+#error "build with -mavx512bw -mavx512vl -mpclmul -mvpclmulqdq"
+#endif
+
+#define crc32_clmul crc32_clmul_avx512
+#define crc64_clmul crc64_clmul_avx512
+#define crc32_vpclmul crc32_vpclmul_avx512
+#define crc64_vpclmul crc64_vpclmul_avx512
+#include "crc_clmul.h"
+#include "crc_vpclmul.h"
@@ -0,0 +1,12 @@
+/*
+ * crc32/64_clmul for the runtime dispatch.
+ * cc -O3 -msse4.1 -mpclmul -c crc_x86_clmul.c
+ */
+
+#if !defined(__SSE4_1__) || !defined(__PCLMUL__)
+#error "build with -msse4.1 -mpclmul"
+#endif
+
+#define crc32_clmul crc32_clmul_x86
+#define crc64_clmul crc64_clmul_x86
+#include "crc_clmul.h"
@@ -1,7 +1,10 @@
-#ifdef PERF_CPU
+/* also for O_DIRECT in crc_reader.h */
+#if defined(PERF_CPU) || defined(__linux__)
 #ifndef _GNU_SOURCE
 #define _GNU_SOURCE
 #endif
+#endif
+#ifdef PERF_CPU
 #include <unistd.h>
 #include <sched.h>
 #endif
@@ -47,6 +50,30 @@ static inline uint64_t get_cycles() { return __rdtsc(); }
 #endif
 #endif
 
+static inline uint64_t crc_ns(void) {
+#ifdef _GNU_SOURCE
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec * 1000000ull + tv.tv_usec) * 1000;
+#endif
+}
+
+/* cycles, or ns without them */
+static inline uint64_t crc_stamp(void) {
+#if WITH_CYCLES
+	return get_cycles();
+#else
+	return crc_ns();
+#endif
+}
+
+#include "crc_stats.h"
+#include "crc_report.h"
+
 #if USE_PERFCNT
 #include "perfcnt.h"
 // CPU is running at nominal frequency and the frequency is known
@@ -89,9 +116,29 @@ static inline uint64_t get_cycles() { return __rdtsc(); }
 
 #endif
 
+/* insn/byte of the best chunk, for the reports */
+#ifndef TIMER_INSNS
+#define TIMER_INSNS -1.0
+#endif
+
 #include "crc_slice.h"
+#include "crc_slice16.h"
+#include "crc_combine.h"
+#include "crc_hwcrc.h"
 #include "crc_clsim.h"
 
+#ifndef HAVE_CLSIMV
+#if defined(__GNUC__) && (defined(__SSE2__) || defined(__ARM_NEON))
+#define HAVE_CLSIMV 1
+#else
+#define HAVE_CLSIMV 0
+#endif
+#endif
+
+#if HAVE_CLSIMV
+#include "crc_clsimv.h"
+#endif
+
 #ifndef HAVE_CLMUL
 #if ((defined(__SSE4_1__) && defined(__PCLMUL__)) || defined(__aarch64__)) \
 		&& !(defined(__e2k__) && __iset__ < 6)
@@ -106,11 +153,98 @@ static inline uint64_t get_cycles() { return __rdtsc(); }
 #define CLSIM_HW
 #define crc32_clsim crc32_clmul2
 #define crc64_clsim crc64_clmul2
+#define crc32_clsim_2x crc32_clmul2_2x
+#define crc64_clsim_2x crc64_clmul2_2x
+#define crc32_clsim_4x crc32_clmul2_4x
+#define crc64_clsim_4x crc64_clmul2_4x
+#define crc64_clsim_step crc64_clmul2_step
 #include "crc_clsim.h"
 #undef crc32_clsim
 #undef crc64_clsim
+#undef crc32_clsim_2x
+#undef crc64_clsim_2x
+#undef crc32_clsim_4x
+#undef crc64_clsim_4x
+#undef crc64_clsim_step
+#endif
+
+#ifndef HAVE_VPCLMUL
+#if HAVE_CLMUL && defined(__VPCLMULQDQ__) && defined(__AVX2__)
+#define HAVE_VPCLMUL 1
+#else
+#define HAVE_VPCLMUL 0
+#endif
+#endif
+
+#if HAVE_VPCLMUL
+#include "crc_vpclmul.h"
+#endif
+
+#if HAVE_CLMUL && !defined(__aarch64__)
+#define HAVE_CLMUL_BATCH 1
+#include "crc_batch.h"
+#include "crc_iov.h"
+#else
+#define HAVE_CLMUL_BATCH 0
+#endif
+
+#include "crc_msb.h"
+#include "crc_stream.h"
+#include "crc_copy.h"
+#if HAVE_CLMUL && defined(__PCLMUL__) && defined(__SSSE3__)
+#define HAVE_CLMUL_MSB 1
+#else
+#define HAVE_CLMUL_MSB 0
+#endif
+
+#ifdef WITH_DISPATCH
+#include "crc_dispatch.h"
+#endif
+
+#ifndef WITH_THREADS
+#if defined(__unix__) || defined(__APPLE__)
+#define WITH_THREADS 1
+#else
+#define WITH_THREADS 0
+#endif
+#endif
+
+#if WITH_THREADS
+#include "crc_parallel.h"
+#endif
+
+#ifndef WITH_MMAP
+#if defined(__unix__) || defined(__APPLE__)
+#define WITH_MMAP 1
+#else
+#define WITH_MMAP 0
+#endif
+#endif
+
+#if WITH_MMAP
+#include "crc_mmap.h"
+#endif
+
+#ifndef WITH_BUFFER
+#ifdef __linux__
+#define WITH_BUFFER 1
+#else
+#define WITH_BUFFER 0
+#endif
+#endif
+
+#if WITH_BUFFER
+#include "crc_buffer.h"
+#endif
+
+#if WITH_THREADS
+#include "crc_reader.h"
 #endif
 
+/* wall time of reading or mapping the input, apart from the CRC time */
+#define IO_START { TIME_DEF TIME_GET
+#define IO_STOP TIME_DIFF io_ms += time * TIME_TO_MS; }
+
 #define POLY32 0xedb88320
 #define POLY64 0xc96c5795d7870f42
 
@@ -166,86 +300,73 @@ uint64_t crc64_simple(const uint8_t *s, size_t n, uint64_t crc) {
 	return crc;
 }
 
-static inline uint32_t crc32_multmodp(uint32_t p, uint32_t a, uint32_t b) {
-	uint32_t x = 0;
-	do {
-		x ^= b & (int32_t)a >> 31;
-		b = b >> 1 ^ ((0 - (b & 1)) & p);
-	} while ((a <<= 1));
-	return x;
+#include "crc_interleave.h"
+
+/* stream count and block size for the *_long variants, tiers for crc32 */
+static crc_interleave_tiers_t crc32_long_cfg;
+static crc_interleave_t crc64_long_cfg;
+#ifdef __SSE4_2__
+static crc_interleave_tiers_t crc32c_long_cfg;
+#endif
+
+#include "crc_hybrid.h"
+
+/* words per crc32 stream and block size for crc32c_hybrid */
+static crc_hybrid_t crc32c_hybrid_cfg;
+
+/* streams = 0: the stripe profile for crc32, 4 streams for crc64 */
+static int crc_long_init(const char *profile, int streams, size_t block, int words) {
+	int err = crc32_interleave_tiers_init(&crc32_long_cfg, POLY32, profile, streams, block);
+	err |= crc64_interleave_init(&crc64_long_cfg, POLY64, streams ? streams : 4, block);
+#ifdef __SSE4_2__
+	err |= crc32_interleave_tiers_init(&crc32c_long_cfg, 0x82f63b78, profile, streams, block);
+#endif
+	err |= crc32c_hybrid_init(&crc32c_hybrid_cfg, words, block);
+	return err;
 }
 
-// M##i = calc_hi(POLY, POLY, i * N * 8 - 32)
+#ifdef CRC_HYBRID
+uint32_t crc32c_hybrid(const uint8_t *s, size_t n, uint32_t c) {
+	return crc32c_hybrid_run(&crc32c_hybrid_cfg, s, n, c);
+}
+#endif
 
-#define CRC32_PARALLEL4(fn, T1, T, N, POLY, M1, M2, M3) \
-	for (; n >= N*4; n -= N*4) { \
-		const uint8_t *e = s + N; \
-		T1 c0 = c, c1 = ~0u, c2 = ~0u, c3 = ~0u; \
-		for (; s < e; s += sizeof(T)) { \
-			c0 = fn(c0, *(T*)s); \
-			c1 = fn(c1, *(T*)(s + N)); \
-			c2 = fn(c2, *(T*)(s + N * 2)); \
-			c3 = fn(c3, *(T*)(s + N * 3)); \
-		} \
-		c = c3; s += N * 3; \
-		c ^= crc32_multmodp(POLY, M3, ~c0); \
-		c ^= crc32_multmodp(POLY, M2, ~c1); \
-		c ^= crc32_multmodp(POLY, M1, ~c2); \
-	}
+uint32_t crc32_slice4_long(const uint8_t *s, size_t n, uint32_t c) {
+	c = ~c;
+	CRC_INTERLEAVE_TIERS(crc32_slice4_step, uint32_t, uint32_t,
+			&crc32_long_cfg, CRC32_MERGE, POLY32)
+	return crc32_slice4(s, n, ~c);
+}
 
-#ifdef __ARM_FEATURE_CRC32
-#include <arm_acle.h>
-uint32_t crc32_arm(const uint8_t *s, size_t n, uint32_t c) {
+uint64_t crc64_slice4_long(const uint8_t *s, size_t n, uint64_t c) {
 	c = ~c;
-#ifdef __aarch64__
-	if (n >= 8) {
-		const uint8_t *e;
-		uintptr_t x = -(uintptr_t)s & 7;
-		if (x & 1) c = __crc32b(c, *s);
-		if (x & 2) c = __crc32h(c, *(uint16_t*)(s + (x & 1)));
-		if (x & 4) c = __crc32w(c, *(uint32_t*)(s + (x & 3)));
-		n -= x; s += x;
-		e = s + n - 7;
-		for (; s < e; s += 8) c = __crc32d(c, *(uint64_t*)s);
-		if (n & 4) c = __crc32w(c, *(uint32_t*)s);
-		if (n & 2) c = __crc32h(c, *(uint16_t*)(s + (n & 4)));
-		if (n & 1) c = __crc32b(c, s[n & 6]);
-	}
-#else
-	if (n >= 4) {
-		const uint8_t *e;
-		uintptr_t x = -(uintptr_t)s & 3;
-		if (x & 1) c = __crc32b(c, *s);
-		if (x & 2) c = __crc32h(c, *(uint16_t*)(s + (x & 1)));
-		n -= x; s += x;
-		e = s + n - 3;
-		for (; s < e; s += 4) c = __crc32w(c, *(uint32_t*)s);
-		if (n & 2) c = __crc32h(c, *(uint16_t*)s);
-		if (n & 1) c = __crc32b(c, s[n & 2]);
-	}
-#endif
-	else
-		for (; n; n--) c = __crc32b(c, *s++);
-	return ~c;
+	CRC_INTERLEAVE(crc64_slice4_step, uint64_t, uint32_t,
+			&crc64_long_cfg, CRC64_MERGE, POLY64)
+	return crc64_slice4(s, n, ~c);
 }
 
+uint64_t crc64_clsim_long(const uint8_t *s, size_t n, uint64_t c) {
+	c = ~c;
+	CRC_INTERLEAVE(crc64_clsim_step, uint64_t, uint64_t,
+			&crc64_long_cfg, CRC64_MERGE, POLY64)
+	return crc64_clsim(s, n, ~c);
+}
+
+#ifdef __ARM_FEATURE_CRC32
 uint32_t crc32_arm_long(const uint8_t *s, size_t n, uint32_t c) {
 	c = ~c;
-#ifdef CRC32_PARALLEL4
 #ifdef __aarch64__
-	CRC32_PARALLEL4(__crc32d, uint32_t, uint64_t, 4096,
-			0xedb88320, 0x09fe548f, 0x83852d0f, 0xe4b54665)
+	CRC_INTERLEAVE_TIERS(__crc32d, uint32_t, uint64_t,
+			&crc32_long_cfg, CRC32_MERGE, POLY32)
 #else
-	CRC32_PARALLEL4(__crc32w, uint32_t, uint32_t, 4096,
-			0xedb88320, 0x09fe548f, 0x83852d0f, 0xe4b54665)
-#endif
+	CRC_INTERLEAVE_TIERS(__crc32w, uint32_t, uint32_t,
+			&crc32_long_cfg, CRC32_MERGE, POLY32)
 #endif
 	return crc32_arm(s, n, ~c);
 }
 #endif
 
-#ifdef __SSE4_2__
-#include <nmmintrin.h>
+#if defined(__SSE4_2__) || defined(CRC_HYBRID)
 uint32_t crc32_micro2(const uint8_t *s, size_t n, uint32_t c) {
 	int j;
 	for (c = ~c; n--;)
@@ -253,131 +374,1069 @@ uint32_t crc32_micro2(const uint8_t *s, size_t n, uint32_t c) {
 		c = c >> 1 ^ ((0 - (c & 1)) & 0x82f63b78);
 	return ~c;
 }
-
-uint32_t crc32_intel(const uint8_t *s, size_t n, uint32_t c) {
-	c = ~c;
-#ifndef __i386__
-	if (n >= 8) {
-		const uint8_t *e;
-		uintptr_t x = -(uintptr_t)s & 7;
-		if (x & 1) c = _mm_crc32_u8(c, *s);
-		if (x & 2) c = _mm_crc32_u16(c, *(uint16_t*)(s + (x & 1)));
-		if (x & 4) c = _mm_crc32_u32(c, *(uint32_t*)(s + (x & 3)));
-		n -= x; s += x;
-		e = s + n - 7;
-		// Avoid redundant zero extensions in the loop
-		// https://gcc.gnu.org/bugzilla/show_bug.cgi?id=106453
-		{
-			uint64_t xc = c;
-			for (; s < e; s += 8) xc = _mm_crc32_u64(xc, *(uint64_t*)s);
-			c = xc;
-		}
-		if (n & 4) c = _mm_crc32_u32(c, *(uint32_t*)s);
-		if (n & 2) c = _mm_crc32_u16(c, *(uint16_t*)(s + (n & 4)));
-		if (n & 1) c = _mm_crc32_u8(c, s[n & 6]);
-	}
-#else
-	if (n >= 4) {
-		const uint8_t *e;
-		uintptr_t x = -(uintptr_t)s & 3;
-		if (x & 1) c = _mm_crc32_u8(c, *s);
-		if (x & 2) c = _mm_crc32_u16(c, *(uint16_t*)(s + (x & 1)));
-		n -= x; s += x;
-		e = s + n - 3;
-		for (; s < e; s += 4) c = _mm_crc32_u32(c, *(uint32_t*)s);
-		if (n & 2) c = _mm_crc32_u16(c, *(uint16_t*)s);
-		if (n & 1) c = _mm_crc32_u8(c, s[n & 2]);
-	}
 #endif
-	else
-		for (; n; n--) c = _mm_crc32_u8(c, *s++);
-	return ~c;
-}
 
+#ifdef __SSE4_2__
 uint32_t crc32_intel_long(const uint8_t *s, size_t n, uint32_t c) {
 	c = ~c;
-#ifdef CRC32_PARALLEL4
 #ifndef __i386__
-	CRC32_PARALLEL4(_mm_crc32_u64, uint64_t, uint64_t, 4096,
-			0x82f63b78, 0x35d73a62, 0x28461564, 0x43eefc9f)
+	CRC_INTERLEAVE_TIERS(_mm_crc32_u64, uint64_t, uint64_t,
+			&crc32c_long_cfg, CRC32_MERGE, 0x82f63b78)
 #else
-	CRC32_PARALLEL4(_mm_crc32_u32, uint32_t, uint32_t, 4096,
-			0x82f63b78, 0x35d73a62, 0x28461564, 0x43eefc9f)
-#endif
+	CRC_INTERLEAVE_TIERS(_mm_crc32_u32, uint32_t, uint32_t,
+			&crc32c_long_cfg, CRC32_MERGE, 0x82f63b78)
 #endif
 	return crc32_intel(s, n, ~c);
 }
+#endif
+
+/*
+ * test data for the checks: n is past two rounds of every *_long tier
+ * and two crc32c_hybrid blocks at the -s/-b/-w settings, plus a tail
+ */
+static uint8_t *crc_check_alloc(uint8_t **mem, int *n) {
+	size_t len = 2 * crc64_long_cfg.streams * crc64_long_cfg.block, m = 0;
+	uint8_t *buf;
+	int i;
 
+	for (i = 0; i < crc32_long_cfg.tiers; i++)
+		m += crc32_long_cfg.t[i].streams * crc32_long_cfg.t[i].block;
+	if (len < 2 * m) len = 2 * m;
+	if (len < 2 * crc32c_hybrid_cfg.block) len = 2 * crc32c_hybrid_cfg.block;
+	*n = (int)len + 1024;
+	if (!(*mem = (uint8_t*)malloc(*n + 15 * 2))) return NULL;
+	buf = (uint8_t*)(((uintptr_t)*mem + 15) & -16);
+	for (i = 0; i < *n + 16; i++) buf[i] = i * 0x76543210u >> 24;
+	return buf;
+}
+
+#if defined(__SSE4_2__) || defined(CRC_HYBRID)
 static int crc32_check2(uint32_t (*crc32_fn)(const uint8_t*, size_t, uint32_t)) {
-	uint8_t buf1[64+15*2], *buf;
-	int i, j, n = 64;
+	uint8_t *buf1, *buf;
+	int i, j, n;
 	uint32_t init = 0x01234567, crc1, crc2;
 
-	buf = (uint8_t*)(((uintptr_t)buf1 + 15) & -16);
-	for (i = 0; i < n + 16; i++) buf[i] = i * 0x76543210u >> 24;
+	if (!(buf = crc_check_alloc(&buf1, &n))) return 2;
 
+	/* up to 1KB at every offset, 32 longer ones at 4 */
 	for (i = 0; i < 16; i++)
-	for (j = 0; j < n; j++) {
+	for (j = 0; j < (i % 5 ? 1024 : n); j = j < 64 ? j + 1 : j < 1024 ? j + 7 : j + (n / 32 | 1)) {
 		crc1 = crc32_micro2(buf + i, j, init);
 		crc2 = crc32_fn(buf + i, j, init);
 		if (crc1 != crc2) {
 			printf("!!! mismatch at (s=%i,n=%i)\n", i, j);
+			free(buf1);
 			return 1;
 		}
 	}
+	free(buf1);
 	return 0;
 }
 #endif
 
 static int crc32_check(uint32_t (*crc32_fn)(const uint8_t*, size_t, uint32_t)) {
-	uint8_t buf1[64+15*2], *buf;
-	int i, j, n = 64;
+	uint8_t *buf1, *buf;
+	int i, j, n;
 	uint32_t init = 0x01234567, crc1, crc2;
 
-	buf = (uint8_t*)(((uintptr_t)buf1 + 15) & -16);
-	for (i = 0; i < n + 16; i++) buf[i] = i * 0x76543210u >> 24;
+	if (!(buf = crc_check_alloc(&buf1, &n))) return 2;
 
+	/* up to 1KB at every offset, 32 longer ones at 4 */
 	for (i = 0; i < 16; i++)
-	for (j = 0; j < n; j++) {
+	for (j = 0; j < (i % 5 ? 1024 : n); j = j < 64 ? j + 1 : j < 1024 ? j + 7 : j + (n / 32 | 1)) {
 		crc1 = crc32_micro(buf + i, j, init);
 		crc2 = crc32_fn(buf + i, j, init);
 		if (crc1 != crc2) {
 			printf("!!! mismatch at (s=%i,n=%i)\n", i, j);
+			free(buf1);
 			return 1;
 		}
 	}
+	free(buf1);
 	return 0;
 }
 
 static int crc64_check(uint64_t (*crc64_fn)(const uint8_t*, size_t, uint64_t)) {
-	uint8_t buf1[64+15*2], *buf;
-	int i, j, n = 64;
+	uint8_t *buf1, *buf;
+	int i, j, n;
 	uint64_t init = 0x0123456789abcdef, crc1, crc2;
 
-	buf = (uint8_t*)(((uintptr_t)buf1 + 15) & -16);
-	for (i = 0; i < n + 16; i++) buf[i] = i * 0x76543210u >> 24;
+	if (!(buf = crc_check_alloc(&buf1, &n))) return 2;
 
+	/* up to 1KB at every offset, 32 longer ones at 4 */
 	for (i = 0; i < 16; i++)
-	for (j = 0; j < n; j++) {
+	for (j = 0; j < (i % 5 ? 1024 : n); j = j < 64 ? j + 1 : j < 1024 ? j + 7 : j + (n / 32 | 1)) {
 		crc1 = crc64_micro(buf + i, j, init);
 		crc2 = crc64_fn(buf + i, j, init);
 		if (crc1 != crc2) {
 			printf("!!! mismatch at (s=%i,n=%i)\n", i, j);
+			free(buf1);
+			return 1;
+		}
+	}
+	free(buf1);
+	return 0;
+}
+
+/* non-reflected: CRC-32/BZIP2 and CRC-64/WE */
+uint32_t crc32_msb_micro(const uint8_t *s, size_t n, uint32_t c) {
+	int j;
+	for (c = ~c; n--;)
+	for (c ^= (uint32_t)*s++ << 24, j = 8; j--;)
+		c = c << 1 ^ ((0 - (c >> 31)) & 0x04c11db7);
+	return ~c;
+}
+
+uint64_t crc64_msb_micro(const uint8_t *s, size_t n, uint64_t c) {
+	int j;
+	for (c = ~c; n--;)
+	for (c ^= (uint64_t)*s++ << 56, j = 8; j--;)
+		c = c << 1 ^ ((0 - (c >> 63)) & 0x42f0e1eba9ea3693);
+	return ~c;
+}
+
+static int crc32_msb_check(uint32_t (*crc32_fn)(const uint8_t*, size_t, uint32_t)) {
+	uint8_t *buf1, *buf;
+	int i, j, n;
+	uint32_t init = 0x01234567, crc1, crc2;
+
+	/* BZIP2 and MPEG-2 check values */
+	if (crc32_fn((const uint8_t*)"123456789", 9, 0) != 0xfc891918 ||
+			~crc32_fn((const uint8_t*)"123456789", 9, 0) != 0x0376e6e7) {
+		printf("!!! wrong check value\n");
+		return 1;
+	}
+	if (!(buf = crc_check_alloc(&buf1, &n))) return 2;
+
+	/* up to 1KB at every offset, 32 longer ones at 4 */
+	for (i = 0; i < 16; i++)
+	for (j = 0; j < (i % 5 ? 1024 : n); j = j < 64 ? j + 1 : j < 1024 ? j + 7 : j + (n / 32 | 1)) {
+		crc1 = crc32_msb_micro(buf + i, j, init);
+		crc2 = crc32_fn(buf + i, j, init);
+		if (crc1 != crc2) {
+			printf("!!! mismatch at (s=%i,n=%i)\n", i, j);
+			free(buf1);
+			return 1;
+		}
+	}
+	free(buf1);
+	return 0;
+}
+
+static int crc64_msb_check(uint64_t (*crc64_fn)(const uint8_t*, size_t, uint64_t)) {
+	uint8_t *buf1, *buf;
+	int i, j, n;
+	uint64_t init = 0x0123456789abcdef, crc1, crc2;
+
+	/* CRC-64/WE and ECMA-182 check values */
+	if (crc64_fn((const uint8_t*)"123456789", 9, 0) != 0x62ec59e3f1a4f00a ||
+			~crc64_fn((const uint8_t*)"123456789", 9, ~(uint64_t)0) != 0x6c40df5f0b497347) {
+		printf("!!! wrong check value\n");
+		return 1;
+	}
+	if (!(buf = crc_check_alloc(&buf1, &n))) return 2;
+
+	/* up to 1KB at every offset, 32 longer ones at 4 */
+	for (i = 0; i < 16; i++)
+	for (j = 0; j < (i % 5 ? 1024 : n); j = j < 64 ? j + 1 : j < 1024 ? j + 7 : j + (n / 32 | 1)) {
+		crc1 = crc64_msb_micro(buf + i, j, init);
+		crc2 = crc64_fn(buf + i, j, init);
+		if (crc1 != crc2) {
+			printf("!!! mismatch at (s=%i,n=%i)\n", i, j);
+			free(buf1);
+			return 1;
+		}
+	}
+	free(buf1);
+	return 0;
+}
+
+static int combine_check(void) {
+	uint8_t buf[1024];
+	int i, n = 1024;
+	uint32_t a32, b32, c32;
+	uint64_t a64, b64, c64;
+
+	for (i = 0; i < 63; i++)
+		if (crc32_x8n_table[i + 1] != crc32_combine_mul(crc32_x8n_table[i], crc32_x8n_table[i]) ||
+				crc64_x8n_table[i + 1] != crc64_combine_mul(crc64_x8n_table[i], crc64_x8n_table[i])) {
+			printf("!!! combine table mismatch at %i\n", i + 1);
+			return 1;
+		}
+	for (i = 0; i < n; i++) buf[i] = i * 0x76543210u >> 24;
+	c32 = crc32_micro(buf, n, 0);
+	c64 = crc64_micro(buf, n, 0);
+	for (i = 0; i <= n; i = i < 16 ? i + 1 : i + 61) {
+		a32 = crc32_micro(buf, i, 0);
+		b32 = crc32_micro(buf + i, n - i, 0);
+		a64 = crc64_micro(buf, i, 0);
+		b64 = crc64_micro(buf + i, n - i, 0);
+		if (crc32_combine(a32, b32, n - i) != c32 ||
+				crc64_combine(a64, b64, n - i) != c64) {
+			printf("!!! combine mismatch at %i\n", i);
+			return 1;
+		}
+	}
+	if (crc32_shift(crc32_shift(c32, 1ull << 40), 3ull << 40) != crc32_shift(c32, 1ull << 42) ||
+			crc64_shift(crc64_shift(c64, 1ull << 40), 3ull << 40) != crc64_shift(c64, 1ull << 42)) {
+		printf("!!! combine mismatch for long lengths\n");
+		return 1;
+	}
+	return 0;
+}
+
+/* keeps the results of the timed calls alive */
+static uint64_t crc_bench_sink;
+
+#ifdef WITH_DISPATCH
+
+/* ns per byte over about 4MB in calls of len bytes */
+static double crc_tune_time(const crc_kernel_t *k, const uint8_t *buf, size_t len) {
+	size_t i, rep = (4 << 20) / len + 1;
+	uint64_t sink = 0;
+	TIME_DEF
+	TIME_GET
+	if (k->fn64) for (i = 0; i < rep; i++) sink += k->fn64(buf, len, i);
+	else for (i = 0; i < rep; i++) sink += k->fn32(buf, len, i);
+	TIME_DIFF
+	crc_bench_sink += sink;
+	return time * TIME_TO_MS * 1e6 / (rep * len);
+}
+
+/*
+ * Benchmarks the dispatch kernels at two lengths per size class and
+ * four offsets, prints crc_tune.h with the fastest one for each class.
+ */
+static int crc_tune(int verbose) {
+	static const char *bits_name[2] = { "crc32", "crc64" };
+	const crc_kernel_t *kernels = crc_kernels(), *k;
+	const crc_kernel_t *best[2][CRC_TUNE_CLASSES] = { { NULL } };
+	double t, tbest[2][CRC_TUNE_CLASSES];
+	size_t len[2], max = (size_t)48 << (2 * CRC_TUNE_CLASSES);
+	uint8_t *buf = malloc(max + 64);
+	int b, c, i, a, r;
+
+	if (!buf) return 2;
+	for (i = 0; i < (int)(max + 64); i++) buf[i] = i * 0x76543210u >> 24;
+
+	for (k = kernels; k->name; k++)
+		if (k->fn64 ? crc64_check(k->fn64) : crc32_check(k->fn32)) return 3;
+
+	printf("/* written by ./main -t tune */\n\n");
+	printf("#if CRC_TUNE_CLASSES != %i\n", CRC_TUNE_CLASSES);
+	printf("#error \"size classes changed, run the tuner again\"\n#endif\n");
+	for (c = 0; c < CRC_TUNE_CLASSES; c++) {
+		/* inside [lo, 4 * lo) */
+		len[0] = c ? (size_t)24 << 2 * c : 16;
+		len[1] = c ? (size_t)48 << 2 * c : 48;
+		if (verbose > 0) printf("\n// %u..%u bytes, ns/byte:\n",
+				(unsigned)len[0], (unsigned)len[1]);
+		for (k = kernels; k->name; k++) {
+			for (t = 0, i = 0; i < 2; i++)
+			for (a = 0; a < 16; a += 5) {
+				double t1, tmin = 0;
+				for (r = 0; r < 3; r++) {
+					t1 = crc_tune_time(k, buf + a, len[i]);
+					if (!r || t1 < tmin) tmin = t1;
+				}
+				t += tmin;
+			}
+			/* a tie goes to the earlier, simpler kernel */
+			b = !!k->fn64;
+			if (!best[b][c] || t < tbest[b][c] * 0.98)
+				best[b][c] = k, tbest[b][c] = t;
+			if (verbose > 0) printf("//   %s: %.4f\n", k->name, t / 8);
+		}
+	}
+	for (b = 0; b < 2; b++) {
+		printf("\nstatic const char *const %s_tune[CRC_TUNE_CLASSES] = {\n",
+				bits_name[b]);
+		for (c = 0; c < CRC_TUNE_CLASSES; c++)
+			printf("\t\"%s\"%s\n", best[b][c]->name,
+					c < CRC_TUNE_CLASSES - 1 ? "," : "");
+		printf("};\n");
+	}
+	free(buf);
+	return crc_bench_sink == 1;
+}
+#endif
+
+typedef struct {
+	const char *name;
+	uint32_t (*fn32)(const uint8_t*, size_t, uint32_t);
+	uint64_t (*fn64)(const uint8_t*, size_t, uint64_t);
+	void (*init)(void);
+	/* NULL for crc32_check/crc64_check */
+	int (*check32)(uint32_t (*)(const uint8_t*, size_t, uint32_t));
+	int (*check64)(uint64_t (*)(const uint8_t*, size_t, uint64_t));
+} crc_variant_t;
+
+#define CRC32_VARIANT(fn, init) { #fn, fn, NULL, init, NULL, NULL },
+#define CRC64_VARIANT(fn, init) { #fn, NULL, fn, init, NULL, NULL },
+#define CRC32_MSB_VARIANT(fn) { #fn, fn, NULL, NULL, crc32_msb_check, NULL },
+#define CRC64_MSB_VARIANT(fn) { #fn, NULL, fn, NULL, NULL, crc64_msb_check },
+
+static const crc_variant_t crc_variants[] = {
+	CRC64_VARIANT(crc64_micro, NULL)
+	CRC64_VARIANT(crc64_simple, crc64_simple_init)
+	CRC64_VARIANT(crc64_slice4, crc64_slice4_init)
+	CRC64_VARIANT(crc64_slice4_long, crc64_slice4_init)
+	CRC64_VARIANT(crc64_slice8, NULL)
+	CRC64_VARIANT(crc64_slice16, NULL)
+	CRC64_VARIANT(crc64_clsim, NULL)
+	CRC64_VARIANT(crc64_clsim_long, NULL)
+	CRC64_VARIANT(crc64_clsim_2x, NULL)
+	CRC64_VARIANT(crc64_clsim_4x, NULL)
+#if HAVE_CLSIMV
+	CRC64_VARIANT(crc64_clsimv, NULL)
+#endif
+#if HAVE_CLMUL
+	CRC64_VARIANT(crc64_clmul, NULL)
+#endif
+#if HAVE_VPCLMUL
+	CRC64_VARIANT(crc64_vpclmul, NULL)
+#endif
+#ifdef CLSIM_HW
+	CRC64_VARIANT(crc64_clmul2, NULL)
+	CRC64_VARIANT(crc64_clmul2_2x, NULL)
+	CRC64_VARIANT(crc64_clmul2_4x, NULL)
+#endif
+#ifdef WITH_DISPATCH
+	{ "crc64_auto", NULL, crc64, NULL, NULL, NULL },
+#endif
+
+	CRC32_VARIANT(crc32_micro, NULL)
+	CRC32_VARIANT(crc32_simple, crc32_simple_init)
+	CRC32_VARIANT(crc32_slice4, crc32_slice4_init)
+	CRC32_VARIANT(crc32_slice4_long, crc32_slice4_init)
+	CRC32_VARIANT(crc32_slice8, NULL)
+	CRC32_VARIANT(crc32_slice16, NULL)
+	CRC32_VARIANT(crc32_clsim, NULL)
+	CRC32_VARIANT(crc32_clsim_2x, NULL)
+	CRC32_VARIANT(crc32_clsim_4x, NULL)
+#if HAVE_CLSIMV
+	CRC32_VARIANT(crc32_clsimv, NULL)
+#endif
+#if HAVE_CLMUL
+	CRC32_VARIANT(crc32_clmul, NULL)
+#endif
+#if HAVE_VPCLMUL
+	CRC32_VARIANT(crc32_vpclmul, NULL)
+#endif
+#ifdef CLSIM_HW
+	CRC32_VARIANT(crc32_clmul2, NULL)
+	CRC32_VARIANT(crc32_clmul2_2x, NULL)
+	CRC32_VARIANT(crc32_clmul2_4x, NULL)
+#endif
+#ifdef __ARM_FEATURE_CRC32
+	CRC32_VARIANT(crc32_arm, NULL)
+	CRC32_VARIANT(crc32_arm_long, NULL)
+#endif
+#ifdef __SSE4_2__
+	{ "crc32_intel", crc32_intel, NULL, NULL, crc32_check2, NULL },
+	{ "crc32_intel_long", crc32_intel_long, NULL, NULL, crc32_check2, NULL },
+#endif
+#ifdef CRC_HYBRID
+	{ "crc32c_hybrid", crc32c_hybrid, NULL, NULL, crc32_check2, NULL },
+#endif
+#ifdef WITH_DISPATCH
+	{ "crc32_auto", crc32, NULL, NULL, NULL, NULL },
+#endif
+	CRC32_MSB_VARIANT(crc32_msb_micro)
+	CRC32_MSB_VARIANT(crc32_msb_clsim)
+	CRC32_MSB_VARIANT(crc32_msb_clsim_4x)
+#if HAVE_CLMUL_MSB
+	CRC32_MSB_VARIANT(crc32_msb_clmul)
+#endif
+	CRC64_MSB_VARIANT(crc64_msb_micro)
+	CRC64_MSB_VARIANT(crc64_msb_clsim)
+#if HAVE_CLMUL_MSB
+	CRC64_MSB_VARIANT(crc64_msb_clmul)
+#endif
+	{ NULL, NULL, NULL, NULL, NULL, NULL }
+};
+
+#undef CRC32_VARIANT
+#undef CRC64_VARIANT
+#undef CRC32_MSB_VARIANT
+#undef CRC64_MSB_VARIANT
+
+/* for the reports, the checks tell the polynomials apart */
+static const char *crc_variant_poly(const crc_variant_t *v) {
+	if (v->fn64) return v->check64 == crc64_msb_check ? "crc64_we" : "crc64_xz";
+#if defined(__SSE4_2__) || defined(CRC_HYBRID)
+	if (v->check32 == crc32_check2) return "crc32c";
+#endif
+	return v->check32 == crc32_msb_check ? "crc32_bzip2" : "crc32";
+}
+
+#if WITH_THREADS
+/* the reflected polynomial for crc*_parallel_fn, *msb for BZIP2 and WE */
+static uint64_t crc_variant_rpoly(const crc_variant_t *v, int *msb) {
+	*msb = v->fn64 ? v->check64 == crc64_msb_check : v->check32 == crc32_msb_check;
+	if (v->fn64) return 0xc96c5795d7870f42;
+#if defined(__SSE4_2__) || defined(CRC_HYBRID)
+	if (v->check32 == crc32_check2) return 0x82f63b78;
+#endif
+	return 0xedb88320;
+}
+
+/* the merged stripes against one call, with a short first stripe */
+static int crc_parallel_check(const crc_variant_t *v, int nthreads) {
+	size_t n = 4 * CRC_PARALLEL_MIN + 1000;
+	uint8_t *buf = malloc(n + 1);
+	uint64_t p, crc1, crc2;
+	int msb, r;
+
+	if (!buf) return 2;
+	for (r = 0; (size_t)r < n + 1; r++) buf[r] = r * 0x76543210u >> 24;
+	p = crc_variant_rpoly(v, &msb);
+	if (v->fn64) {
+		crc1 = v->fn64(buf + 1, n, 0x0123456789abcdef);
+		crc2 = crc64_parallel_fn(v->fn64, p, msb, buf + 1, n, 0x0123456789abcdef, nthreads);
+	} else {
+		crc1 = v->fn32(buf + 1, n, 0x01234567);
+		crc2 = crc32_parallel_fn(v->fn32, (uint32_t)p, msb, buf + 1, n, 0x01234567, nthreads);
+	}
+	free(buf);
+	if (crc1 != crc2) {
+		printf("!!! -j %i mismatch\n", nthreads);
+		return 1;
+	}
+	return 0;
+}
+#endif
+
+#define CRC_SWEEP_RUNS 64
+/* calls of len bytes in one sample, at least 1MB */
+#define CRC_SWEEP_REP(len) ((1 << 20) / (len) + 1)
+
+/* cycles (or ns) per byte of one sample, its ms and cycles in *ms and *stamps */
+static double crc_sweep_sample(const crc_variant_t *v, const uint8_t *buf, size_t len,
+		double *ms, uint64_t *stamps) {
+	size_t i, rep = CRC_SWEEP_REP(len);
+	uint64_t sink = 0;
+	double t;
+	TIME_DEF
+#if WITH_CYCLES
+	uint64_t cycles;
+#endif
+
+	TIME_GET
+#if WITH_CYCLES
+	cycles = get_cycles();
+#endif
+	if (v->fn64) for (i = 0; i < rep; i++) sink += v->fn64(buf, len, i);
+	else for (i = 0; i < rep; i++) sink += v->fn32(buf, len, i);
+#if WITH_CYCLES
+	cycles = get_cycles() - cycles;
+	t = (double)cycles / (rep * len);
+	*stamps = cycles;
+#else
+	*stamps = 0;
+#endif
+	TIME_DIFF
+#if !WITH_CYCLES
+	t = time * TIME_TO_MS * 1e6 / (rep * len);
+#endif
+	*ms = time * TIME_TO_MS;
+	crc_bench_sink += sink;
+	return t;
+}
+
+/* the best of runs samples */
+static double crc_sweep_time(const crc_variant_t *v, const uint8_t *buf, size_t len, int runs) {
+	double t, best = 0, ms;
+	uint64_t stamps;
+	int r;
+
+	for (r = 0; r < runs; r++) {
+		t = crc_sweep_sample(v, buf, len, &ms, &stamps);
+		if (!r || t < best) best = t;
+	}
+	return best;
+}
+
+/*
+ * the records of the sweep, from runs passes over all the points, so a
+ * slow spell of the machine widens the stddev of the points it hit
+ * instead of shifting the whole of a few variants
+ */
+static int crc_sweep_records(const uint8_t *buf, size_t maxlen,
+		const int *offs, int noffs, int runs) {
+	const crc_variant_t *v;
+	size_t n, k, np = 0;
+	uint64_t *ns, *stamps;
+	double *t, *ms;
+	int i, r;
+
+	for (v = crc_variants; v->name; v++)
+		for (n = 1; n <= maxlen; n *= 4) np += noffs;
+	t = (double*)malloc(2 * np * runs * sizeof(*t));
+	ns = (uint64_t*)calloc(2 * np, sizeof(*ns));
+	if (!t || !ns) {
+		free(t); free(ns);
+		return 2;
+	}
+	ms = t + np * runs; stamps = ns + np;
+
+	for (r = 0; r < runs; r++)
+	for (k = 0, v = crc_variants; v->name; v++) {
+		if (v->init) v->init();
+		for (n = 1; n <= maxlen; n *= 4)
+		for (i = 0; i < noffs; i++, k++) {
+			uint64_t c;
+			t[k * runs + r] = crc_sweep_sample(v, buf + offs[i], n, &ms[k * runs + r], &c);
+			ns[k] += ms[k * runs + r] * 1e6; stamps[k] += c;
+		}
+	}
+
+	for (k = 0, v = crc_variants; v->name; v++)
+	for (n = 1; n <= maxlen; n *= 4)
+	for (i = 0; i < noffs; i++, k++) {
+		crc_record_t rec = { 0 };
+		crc_stats_t st, tt;
+		crc_stats_calc(&st, t + k * runs, runs);
+		crc_stats_calc(&tt, ms + k * runs, runs);
+		rec.variant = v->name; rec.poly = crc_variant_poly(v);
+		rec.unit = WITH_CYCLES ? "cycles" : "ns";
+		rec.len = n; rec.align = offs[i]; rec.runs = runs;
+		rec.ms = tt.median; rec.cpb = st.median;
+		rec.cpb_min = st.min; rec.cpb_p90 = st.p90;
+		rec.stddev = 100 * st.stddev / st.mean;
+		rec.insn = -1;
+		rec.ghz = WITH_CYCLES && ns[k] ? (double)stamps[k] / ns[k] : 0;
+		rec.gbps = tt.median ? CRC_SWEEP_REP(n) * n / tt.median * 1e-6 : 0;
+		crc_report(&rec);
+	}
+	free(t); free(ns);
+	return 0;
+}
+
+/*
+ * every variant at lengths 1..maxlen by 4x, at offsets each side of 4..32,
+ * runs (at least 3) samples per point
+ */
+static int crc_sweep(size_t maxlen, int runs) {
+	static const int offs[] = { 0, 1, 3, 4, 7, 8, 15, 16, 31, 32, 63 };
+	const int noffs = sizeof(offs) / sizeof(offs[0]);
+	const crc_variant_t *v;
+	uint8_t *buf;
+	size_t n;
+	int i;
+
+	if (maxlen > (size_t)64 << 20) maxlen = (size_t)64 << 20;
+	if (runs < 3) runs = 3;
+	if (runs > CRC_SWEEP_RUNS) runs = CRC_SWEEP_RUNS;
+	if (!(buf = malloc(maxlen + 64))) return 2;
+	for (n = 0; n < maxlen + 64; n++) buf[n] = n * 0x76543210u >> 24;
+
+	for (v = crc_variants; v->name; v++) {
+		if (v->init) v->init();
+		if ((v->fn64 ? (v->check64 ? v->check64 : crc64_check)(v->fn64) :
+				(v->check32 ? v->check32 : crc32_check)(v->fn32))
+#if WITH_THREADS
+				|| crc_parallel_check(v, 4)
+#endif
+				) {
+			free(buf);
+			return 3;
+		}
+	}
+	if (crc_format != CRC_FMT_TEXT) {
+		crc_report_header();
+		i = crc_sweep_records(buf, maxlen, offs, noffs, runs);
+		free(buf);
+		return i ? i : crc_bench_sink == 1;
+	}
+
+	for (v = crc_variants; v->name; v++) {
+		if (v->init) v->init();
+		printf("%s, %s by length and offset:\n%9s", v->name,
+				WITH_CYCLES ? "cycles/byte" : "ns/byte", "");
+		for (i = 0; i < noffs; i++) printf(" %7i", offs[i]);
+		printf("\n");
+		for (n = 1; n <= maxlen; n *= 4) {
+			printf("%9lu", (unsigned long)n);
+			for (i = 0; i < noffs; i++)
+				printf(" %7.3f", crc_sweep_time(v, buf + offs[i], n, runs));
+			printf("\n");
+			fflush(stdout);
+		}
+		printf("\n");
+	}
+	free(buf);
+	return crc_bench_sink == 1;
+}
+
+#if HAVE_CLMUL_BATCH
+static int crc_batch_check(void) {
+	uint8_t buf[1024 + 64];
+	const uint8_t *bufs[600]; size_t lens[600];
+	uint32_t out32[600]; uint64_t out64[600];
+	int i, n = 600;
+
+	for (i = 0; i < (int)sizeof(buf); i++) buf[i] = i * 0x76543210u >> 24;
+	/* more than one sorted chunk, with a run of equal lengths */
+	for (i = 0; i < n; i++) {
+		bufs[i] = buf + i * 7 % 64;
+		lens[i] = i < 40 ? i : i < 300 || i >= 400 ? i * 37 % 1024 : 40;
+	}
+	/* also fewer messages than lanes */
+	crc32_clmul_batch(bufs, lens, out32, 2);
+	crc64_clmul_batch(bufs, lens, out64, 2);
+	for (i = 0; i < n; i++) {
+		if (i == 2) {
+			crc32_clmul_batch(bufs, lens, out32, n);
+			crc64_clmul_batch(bufs, lens, out64, n);
+		}
+		if (out32[i] != crc32_micro(bufs[i], lens[i], 0) ||
+				out64[i] != crc64_micro(bufs[i], lens[i], 0)) {
+			printf("!!! batch mismatch at (i=%i,n=%i)\n", i, (int)lens[i]);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* packets of lo..hi bytes back to back in buf, checksummed until len bytes */
+static int crc_batch_run(int bits, int batch, const uint8_t **bufs,
+		const size_t *lens, size_t count, size_t n, size_t len, int verbose) {
+	const char *type = bits == 32 ?
+			batch ? "crc32_clmul_batch" : "crc32_clmul per packet" :
+			batch ? "crc64_clmul_batch" : "crc64_clmul per packet";
+	uint32_t *out32 = malloc(count * sizeof(*out32));
+	uint64_t *out64 = malloc(count * sizeof(*out64)), crc = 0;
+	size_t i;
+	TIMER_DEF
+
+	if (!out32 || !out64) return 2;
+	TIMER_INIT
+	for (; len >= n; len -= n) {
+		TIMER_START
+		if (bits == 32 && batch)
+			crc32_clmul_batch(bufs, lens, out32, count);
+		else if (bits == 32)
+			for (i = 0; i < count; i++) out32[i] = crc32_clmul(bufs[i], lens[i], 0);
+		else if (batch)
+			crc64_clmul_batch(bufs, lens, out64, count);
+		else
+			for (i = 0; i < count; i++) out64[i] = crc64_clmul(bufs[i], lens[i], 0);
+		TIMER_STOP
+	}
+	for (i = 0; i < count; i++) crc ^= bits == 32 ? out32[i] : out64[i];
+	if (bits == 32) printf("%08x", (uint32_t)crc);
+	else printf("%016llx", (long long)crc);
+	if (verbose > 0) {
+		TIMER_PRINT
+	}
+	printf("\n");
+	free(out32); free(out64);
+	return 0;
+}
+
+static int crc_batch_bench(int bits, size_t lo, size_t hi,
+		size_t nbuf, size_t len, int verbose) {
+	uint8_t *buf = malloc(nbuf);
+	const uint8_t **bufs = malloc((nbuf / lo + 1) * sizeof(*bufs));
+	size_t *lens = malloc((nbuf / lo + 1) * sizeof(*lens));
+	size_t i, n = 0, count = 0;
+	uint32_t seed = 1;
+	int err;
+
+	if (!buf || !bufs || !lens) return 2;
+	if (crc_batch_check()) return 3;
+	for (i = 0; i < nbuf; i++) buf[i] = i * 0x76543210u >> 24;
+	for (;;) {
+		seed = seed * 1103515245 + 12345;
+		i = lo + (seed >> 8) % (hi - lo + 1);
+		if (n + i > nbuf) break;
+		bufs[count] = buf + n; lens[count++] = i; n += i;
+	}
+	if (!count) return 1;
+	if (len < n) len = n;
+	err = crc_batch_run(bits, 0, bufs, lens, count, n, len, verbose);
+	if (!err) err = crc_batch_run(bits, 1, bufs, lens, count, n, len, verbose);
+	free(buf); free(bufs); free(lens);
+	return err;
+}
+
+/* segments of 0..40 bytes, some at the end of a page, and long ones */
+static int crc_iov_check(void) {
+	static uint8_t buf[3 * 4096] __attribute__((aligned(4096)));
+	struct iovec iov[64];
+	size_t i, n;
+	int k, count;
+
+	for (i = 0; i < sizeof(buf); i++) buf[i] = i * 0x76543210u >> 24;
+	for (k = 1; k < 200; k++) {
+		uint8_t *p = buf + k * 7 % 61;
+		uint32_t c32 = 0x12345678; uint64_t c64 = 0x123456789abcdef0;
+		count = k % 64;
+		for (i = 0; i < (size_t)count; i++) {
+			n = k < 100 ? (i * k + k) % 41 : (i * k) % 701;
+			if (i == 5) p = buf + 4096 - n;
+			if (i == 6) p = buf + 2 * 4096 - n - 15;
+			iov[i].iov_base = p; iov[i].iov_len = n;
+			c32 = crc32_micro(p, n, c32); c64 = crc64_micro(p, n, c64);
+			p += n + i % 3;
+		}
+		if (crc32_iov(iov, count, 0x12345678) != c32 ||
+				crc64_iov(iov, count, 0x123456789abcdef0) != c64) {
+			printf("!!! iov mismatch at (k=%i,count=%i)\n", k, count);
 			return 1;
 		}
 	}
 	return 0;
 }
 
+/*
+ * chains of 2..64 segments of lo..hi bytes: a kernel call per segment,
+ * a copy to one buffer and a call, or crc_iov
+ */
+static int crc_iov_run(int bits, int mode, const struct iovec *iov,
+		const int *chains, size_t nchains, uint8_t *tmp, size_t n, size_t len, int verbose) {
+	static const char *types[2][3] = {
+		{ "crc32_clmul per segment", "memcpy + crc32_clmul", "crc32_iov" },
+		{ "crc64_clmul per segment", "memcpy + crc64_clmul", "crc64_iov" }
+	};
+	const char *type = types[bits == 64][mode];
+	uint64_t crc = 0;
+	size_t c;
+	int i;
+	TIMER_DEF
+
+	TIMER_INIT
+	for (; len >= n; len -= n) {
+		const struct iovec *v = iov;
+		crc = 0;
+		TIMER_START
+		for (c = 0; c < nchains; v += chains[c++]) {
+			if (mode == 0 && bits == 32) {
+				uint32_t x = 0;
+				for (i = 0; i < chains[c]; i++)
+					x = crc32_clmul((const uint8_t*)v[i].iov_base, v[i].iov_len, x);
+				crc ^= x;
+			} else if (mode == 0) {
+				uint64_t x = 0;
+				for (i = 0; i < chains[c]; i++)
+					x = crc64_clmul((const uint8_t*)v[i].iov_base, v[i].iov_len, x);
+				crc ^= x;
+			} else if (mode == 1) {
+				size_t k = 0;
+				for (i = 0; i < chains[c]; i++) {
+					memcpy(tmp + k, v[i].iov_base, v[i].iov_len);
+					k += v[i].iov_len;
+				}
+				crc ^= bits == 32 ? crc32_clmul(tmp, k, 0) : crc64_clmul(tmp, k, 0);
+			} else {
+				crc ^= bits == 32 ? crc32_iov(v, chains[c], 0) : crc64_iov(v, chains[c], 0);
+			}
+		}
+		TIMER_STOP
+	}
+	if (bits == 32) printf("%08x", (uint32_t)crc);
+	else printf("%016llx", (long long)crc);
+	if (verbose > 0) {
+		TIMER_PRINT
+	}
+	printf("\n");
+	return 0;
+}
+
+static int crc_iov_bench(int bits, size_t lo, size_t hi,
+		size_t nbuf, size_t len, int verbose) {
+	uint8_t *buf = malloc(nbuf), *tmp = malloc(64 * hi);
+	struct iovec *iov = malloc((nbuf / lo + 1) * sizeof(*iov));
+	int *chains = malloc((nbuf / lo + 1) * sizeof(*chains));
+	size_t i, n = 0, count = 0, nchains = 0;
+	uint32_t seed = 1;
+	int k, err = 0;
+
+	if (!buf || !tmp || !iov || !chains) return 2;
+	if (crc_iov_check()) return 3;
+	for (i = 0; i < nbuf; i++) buf[i] = i * 0x76543210u >> 24;
+	for (;;) {
+		seed = seed * 1103515245 + 12345;
+		k = 2 + (seed >> 8) % 63;
+		for (i = count; i < count + k; i++) {
+			seed = seed * 1103515245 + 12345;
+			iov[i].iov_len = lo + (seed >> 8) % (hi - lo + 1);
+			iov[i].iov_base = buf + n;
+			n += iov[i].iov_len;
+		}
+		if (n > nbuf) break;
+		chains[nchains++] = k; count += k;
+	}
+	for (n = i = 0; i < count; i++) n += iov[i].iov_len;
+	if (!nchains) return 1;
+	if (len < n) len = n;
+	for (k = 0; k < 3 && !err; k++)
+		err = crc_iov_run(bits, k, iov, chains, nchains, tmp, n, len, verbose);
+	free(buf); free(tmp); free(iov); free(chains);
+	return err;
+}
+#endif
+
+/* updates of 0..700 bytes, across and over whole carry blocks */
+static int crc_stream_check(const crc_variant_t *v) {
+	uint8_t buf[8192];
+	size_t i, n, k;
+
+	for (i = 0; i < sizeof(buf); i++) buf[i] = i * 0x76543210u >> 24;
+	for (k = 1; k < 40; k++) {
+		crc32_ctx_t c32; crc64_ctx_t c64;
+		uint64_t crc;
+		if (v->fn64) crc64_ctx_init(&c64, v->fn64, 0);
+		else crc32_ctx_init(&c32, v->fn32, 0);
+		for (i = n = 0; n + 700 < sizeof(buf); n += i) {
+			i = (n * k + k) % 701;
+			if (v->fn64) crc64_ctx_update(&c64, buf + n, i);
+			else crc32_ctx_update(&c32, buf + n, i);
+		}
+		crc = v->fn64 ? crc64_ctx_final(&c64) : crc32_ctx_final(&c32);
+		if (crc != (v->fn64 ? v->fn64(buf, n, 0) : v->fn32(buf, n, 0))) {
+			printf("!!! stream mismatch at (k=%i,n=%i)\n", (int)k, (int)n);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* any kernel, fed by fragments of lo..hi bytes: one call each, or a ctx */
+static int crc_stream_run(const crc_variant_t *v, int ctx, const size_t *lens,
+		size_t count, const uint8_t *buf, size_t n, size_t len, int verbose) {
+	uint64_t crc = 0;
+	size_t i;
+	char type[64];
+	TIMER_DEF
+
+	snprintf(type, sizeof(type), "%s %s", v->name, ctx ? "ctx" : "per fragment");
+	TIMER_INIT
+	for (; len >= n; len -= n) {
+		const uint8_t *s = buf;
+		TIMER_START
+		if (v->fn64 && ctx) {
+			crc64_ctx_t c;
+			crc64_ctx_init(&c, v->fn64, 0);
+			for (i = 0; i < count; s += lens[i++]) crc64_ctx_update(&c, s, lens[i]);
+			crc = crc64_ctx_final(&c);
+		} else if (v->fn64) {
+			for (crc = 0, i = 0; i < count; s += lens[i++]) crc = v->fn64(s, lens[i], crc);
+		} else if (ctx) {
+			crc32_ctx_t c;
+			crc32_ctx_init(&c, v->fn32, 0);
+			for (i = 0; i < count; s += lens[i++]) crc32_ctx_update(&c, s, lens[i]);
+			crc = crc32_ctx_final(&c);
+		} else {
+			uint32_t c = 0;
+			for (i = 0; i < count; s += lens[i++]) c = v->fn32(s, lens[i], c);
+			crc = c;
+		}
+		TIMER_STOP
+	}
+	if (crc != (v->fn64 ? v->fn64(buf, n, 0) : v->fn32(buf, n, 0))) {
+		printf("!!! %s mismatch with %s\n", v->name, ctx ? "ctx" : "fragments");
+		return 3;
+	}
+	printf(v->fn64 ? "%016llx" : "%08llx", (unsigned long long)crc);
+	if (verbose > 0) {
+		TIMER_PRINT
+	}
+	printf("\n");
+	return 0;
+}
+
+static int crc_stream_bench(const crc_variant_t *v, size_t lo, size_t hi,
+		size_t nbuf, size_t len, int verbose) {
+	uint8_t *buf = malloc(nbuf);
+	size_t *lens = malloc((nbuf / lo + 1) * sizeof(*lens));
+	size_t i, n = 0, count = 0;
+	uint32_t seed = 1;
+	int err;
+
+	if (!buf || !lens) return 2;
+	if (crc_stream_check(v)) return 3;
+	for (i = 0; i < nbuf; i++) buf[i] = i * 0x76543210u >> 24;
+	for (;;) {
+		seed = seed * 1103515245 + 12345;
+		i = lo + (seed >> 8) % (hi - lo + 1);
+		if (n + i > nbuf) break;
+		lens[count++] = i; n += i;
+	}
+	if (!count) return 1;
+	if (len < n) len = n;
+	err = crc_stream_run(v, 0, lens, count, buf, n, len, verbose);
+	if (!err) err = crc_stream_run(v, 1, lens, count, buf, n, len, verbose);
+	free(buf); free(lens);
+	return err;
+}
+
+/* memcpy and a kernel, or a _copy kernel with or without non-temporal stores */
+typedef struct {
+	const char *name; int nt;
+	uint32_t (*copy32)(uint8_t*, const uint8_t*, size_t, uint32_t);
+	uint64_t (*copy64)(uint8_t*, const uint8_t*, size_t, uint64_t);
+	uint32_t (*fn32)(const uint8_t*, size_t, uint32_t);
+	uint64_t (*fn64)(const uint8_t*, size_t, uint64_t);
+} crc_copy_mode_t;
+
+static const crc_copy_mode_t crc_copy_modes[] = {
+#if HAVE_CLMUL
+	{ "memcpy + crc32_clmul", 0, NULL, NULL, crc32_clmul, NULL },
+	{ "crc32_clmul_copy", 0, crc32_clmul_copy, NULL, NULL, NULL },
+	{ "crc32_clmul_copy nt", 1, crc32_clmul_copy, NULL, NULL, NULL },
+	{ "memcpy + crc64_clmul", 0, NULL, NULL, NULL, crc64_clmul },
+	{ "crc64_clmul_copy", 0, NULL, crc64_clmul_copy, NULL, NULL },
+	{ "crc64_clmul_copy nt", 1, NULL, crc64_clmul_copy, NULL, NULL },
+#endif
+	{ "memcpy + crc32_clsim", 0, NULL, NULL, crc32_clsim, NULL },
+	{ "crc32_clsim_copy", 0, crc32_clsim_copy, NULL, NULL, NULL },
+	{ "crc32_clsim_copy nt", 1, crc32_clsim_copy, NULL, NULL, NULL },
+	{ "memcpy + crc64_clsim", 0, NULL, NULL, NULL, crc64_clsim },
+	{ "crc64_clsim_copy", 0, NULL, crc64_clsim_copy, NULL, NULL },
+	{ "crc64_clsim_copy nt", 1, NULL, crc64_clsim_copy, NULL, NULL },
+	{ "memcpy + crc32_slice8", 0, NULL, NULL, crc32_slice8, NULL },
+	{ "crc32_slice8_copy", 0, crc32_slice8_copy, NULL, NULL, NULL },
+	{ "crc32_slice8_copy nt", 1, crc32_slice8_copy, NULL, NULL, NULL },
+	{ "memcpy + crc64_slice8", 0, NULL, NULL, NULL, crc64_slice8 },
+	{ "crc64_slice8_copy", 0, NULL, crc64_slice8_copy, NULL, NULL },
+	{ "crc64_slice8_copy nt", 1, NULL, crc64_slice8_copy, NULL, NULL },
+	{ NULL, 0, NULL, NULL, NULL, NULL }
+};
+
+/* every length 0..300 and offsets of dst and src */
+static int crc_copy_check(const crc_copy_mode_t *m) {
+	uint8_t src[512], dst[512];
+	size_t i, n;
+
+	for (i = 0; i < sizeof(src); i++) src[i] = i * 0x76543210u >> 24;
+	for (n = 0; n <= 300; n++) {
+		size_t a = n % 17, b = n * 7 % 19;
+		uint64_t crc, ref;
+		memset(dst, 0, sizeof(dst));
+		if (m->copy32) {
+			crc = m->copy32(dst + b, src + a, n, 0x12345678);
+			ref = crc32_micro(src + a, n, 0x12345678);
+		} else {
+			crc = m->copy64(dst + b, src + a, n, 0x123456789abcdef0);
+			ref = crc64_micro(src + a, n, 0x123456789abcdef0);
+		}
+		if (crc != ref || memcmp(dst + b, src + a, n) || dst[b + n]) {
+			printf("!!! %s mismatch at (n=%i)\n", m->name, (int)n);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* n bytes copied and checksummed until len bytes */
+static int crc_copy_bench(int bits, size_t n, size_t len, int verbose) {
+	uint8_t *src = malloc(n), *dst = malloc(n);
+	const crc_copy_mode_t *m;
+	size_t i, l;
+
+	if (!src || !dst) return 2;
+	for (i = 0; i < n; i++) src[i] = i * 0x76543210u >> 24;
+	if (len < n) len = n;
+	for (m = crc_copy_modes; m->name; m++) {
+		const char *type = m->name;
+		uint64_t crc = 0;
+		TIMER_DEF
+
+		if (bits == 32 ? !m->copy32 && !m->fn32 : !m->copy64 && !m->fn64) continue;
+		if (m->copy32 || m->copy64) {
+			crc_copy_nt = m->nt ? 0 : (size_t)-1;
+			if (crc_copy_check(m)) return 3;
+		}
+		memset(dst, 0, n);
+		TIMER_INIT
+		for (l = len; l >= n; l -= n) {
+			TIMER_START
+			if (m->copy32) crc = m->copy32(dst, src, n, 0);
+			else if (m->copy64) crc = m->copy64(dst, src, n, 0);
+			else {
+				memcpy(dst, src, n);
+				crc = m->fn32 ? m->fn32(dst, n, 0) : m->fn64(dst, n, 0);
+			}
+			TIMER_STOP
+		}
+		if (memcmp(dst, src, n)) {
+			printf("!!! %s copy mismatch\n", type);
+			return 3;
+		}
+		if (bits == 32) printf("%08x", (uint32_t)crc);
+		else printf("%016llx", (long long)crc);
+		if (verbose > 0) {
+			TIMER_PRINT
+		}
+		printf("\n");
+	}
+	crc_copy_nt = CRC_COPY_NT;
+	free(src); free(dst);
+	return 0;
+}
+
+/*
+ * -W warm-up passes over the data, then -r timed ones. TIMER_* only see
+ * the last pass, each pass is a sample for crc_stats.h.
+ */
+#define RUN_BEGIN \
+	for (run = -warmup; run < runs; run++) { \
+		crc = 0; len = len0; nmap = nmap0; stamp = 0; ns = 0; bytes = 0;
+
+#define RUN_START \
+	ns -= crc_ns(); stamp -= crc_stamp(); \
+	if (run == runs - 1) { TIMER_START }
+
+#define RUN_STOP \
+	if (run == runs - 1) { TIMER_STOP } \
+	stamp += crc_stamp(); ns += crc_ns(); bytes += n;
+
+#define RUN_END \
+		if (run > -warmup && crc != crc1) { \
+			printf("!!! the CRC differs between runs\n"); \
+			return 3; \
+		} \
+		crc1 = crc; \
+		if (run >= 0) { \
+			samples[run] = bytes ? (double)stamp / bytes : 0; \
+			times[run] = ns * 1e-6; \
+			stamps += stamp; ns_all += ns; \
+		} \
+	}
+
 int main(int argc, char **argv) {
 	uint32_t (*crc32_fn)(const uint8_t*, size_t, uint32_t) = NULL;
 	uint64_t (*crc64_fn)(const uint8_t*, size_t, uint64_t) = NULL;
 	int (*crc32_check_fn)(uint32_t (*)(const uint8_t*, size_t, uint32_t)) = crc32_check;
+	int (*crc64_check_fn)(uint64_t (*)(const uint8_t*, size_t, uint64_t)) = crc64_check;
+	const crc_variant_t *v;
 	uint8_t *buf;
-	size_t n, len = 100 * 1000000, nbuf = 1 << 20;
+	const uint8_t *data, *map = NULL;
+	size_t n, len = 100 * 1000000, nbuf = 1 << 20, nmap = 0, len0, nmap0, bytes;
+	uint64_t stamp, ns, stamps = 0, ns_all = 0;
+	double *samples, *times;
+	crc_record_t rec;
+	int runs = 1, warmup = -1, run, bopt = 0;
+	/* the generated data is rotated over arena bytes of buf */
+	size_t arena = 0, arena_pos = 0;
+#if WITH_BUFFER
+	crc_buffer_t bufopt;
+#endif
+	const char *compare0 = NULL, *compare1 = NULL;
+	double gate = 2;
+	double io_ms = 0;
+	const char *io_name = "read";
 	FILE *f = NULL;
-	int verbose = 1;
-	const char *type = "crc64_simple";
+	int verbose = 1, nthreads = 1, streams = 0, words = 2, map_flags = -1;
+#if WITH_THREADS
+	crc_reader_t reader, *rd = NULL;
+	int depth = 0, read_flags = 0, msb;
+	uint64_t rpoly;
+#endif
+	size_t block = 4096, plo = 40, phi = 512;
+	const char *type = "crc64_simple", *profile = "auto";
 	TIMER_DEF
 
 	while (argc > 1) {
@@ -395,64 +1454,110 @@ int main(int argc, char **argv) {
 		} else if (argc > 2 && !strcmp(argv[1], "-l")) {
 			len = atol(argv[2]);
 			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-s")) {
+			streams = atoi(argv[2]);
+			if (!streams) profile = argv[2];
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-b")) {
+			block = atol(argv[2]);
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-w")) {
+			words = atoi(argv[2]);
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-j")) {
+			nthreads = atoi(argv[2]);
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-p")) {
+			const char *e = strchr(argv[2], '-');
+			plo = phi = atol(argv[2]);
+			if (e) phi = atol(e + 1);
+			if (!plo || phi < plo) return 1;
+			argc -= 2; argv += 2;
+#if WITH_MMAP
+		} else if (argc > 2 && !strcmp(argv[1], "-m")) {
+			map_flags = crc_map_flags(argv[2]);
+			argc -= 2; argv += 2;
+#endif
+#if WITH_THREADS
+		} else if (argc > 2 && !strcmp(argv[1], "-q")) {
+			depth = atoi(argv[2]);
+			read_flags = crc_reader_flags(argv[2]);
+			argc -= 2; argv += 2;
+#endif
+#if USE_PERFCNT
+		} else if (argc > 2 && !strcmp(argv[1], "-e")) {
+			perf_events = argv[2];
+			argc -= 2; argv += 2;
+#endif
+		} else if (argc > 1 && !strncmp(argv[1], "--format=", 9)) {
+			if ((crc_format = crc_format_parse(argv[1] + 9)) < 0) return 1;
+			argc -= 1; argv += 1;
+		} else if (argc > 3 && !strcmp(argv[1], "-c")) {
+			compare0 = argv[2]; compare1 = argv[3];
+			argc -= 3; argv += 3;
+		} else if (argc > 2 && !strcmp(argv[1], "-g")) {
+			gate = atof(argv[2]);
+			argc -= 2; argv += 2;
+#if WITH_BUFFER
+		} else if (argc > 2 && !strcmp(argv[1], "-B")) {
+			if (crc_buffer_opts(&bufopt, argv[2])) return 1;
+			bopt = 1;
+			argc -= 2; argv += 2;
+#endif
+		} else if (argc > 2 && !strcmp(argv[1], "-r")) {
+			runs = atoi(argv[2]);
+			if (runs < 1) return 1;
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-W")) {
+			warmup = atoi(argv[2]);
+			if (warmup < 0) return 1;
+			argc -= 2; argv += 2;
 		} else if (argc > 2 && !strcmp(argv[1], "-v")) {
 			verbose = atoi(argv[2]);
 			argc -= 2; argv += 2;
 		} else return 1;
 	}
 
+	if (compare0) return crc_compare(compare0, compare1, gate, verbose);
 	if (!type) return 1;
+	if (crc_long_init(profile, streams, block, words)) return 1;
 
-	if (!strcmp(type, "crc64_micro")) {
-		crc64_fn = crc64_micro;
-	} else if (!strcmp(type, "crc64_simple")) {
-		crc64_fn = crc64_simple; crc64_simple_init();
-	} else if (!strcmp(type, "crc64_slice4")) {
-		crc64_fn = crc64_slice4; crc64_slice4_init();
-	} else if (!strcmp(type, "crc64_clsim")) {
-		crc64_fn = crc64_clsim;
-#if HAVE_CLMUL
-	} else if (!strcmp(type, "crc64_clmul")) {
-		crc64_fn = crc64_clmul;
+#ifdef WITH_DISPATCH
+	if (!strcmp(type, "tune")) return crc_tune(verbose);
+	if (!strcmp(type, "auto")) type = "crc64_auto";
 #endif
-#ifdef CLSIM_HW
-	} else if (!strcmp(type, "crc64_clmul2")) {
-		crc64_fn = crc64_clmul2;
-#endif
-
-	} else if (!strcmp(type, "crc32_micro")) {
-		crc32_fn = crc32_micro;
-	} else if (!strcmp(type, "crc32_simple")) {
-		crc32_fn = crc32_simple; crc32_simple_init();
-	} else if (!strcmp(type, "crc32_slice4")) {
-		crc32_fn = crc32_slice4; crc32_slice4_init();
-	} else if (!strcmp(type, "crc32_clsim")) {
-		crc32_fn = crc32_clsim;
-#if HAVE_CLMUL
-	} else if (!strcmp(type, "crc32_clmul")) {
-		crc32_fn = crc32_clmul;
-#endif
-#ifdef CLSIM_HW
-	} else if (!strcmp(type, "crc32_clmul2")) {
-		crc32_fn = crc32_clmul2;
-#endif
-#ifdef __ARM_FEATURE_CRC32
-	} else if (!strcmp(type, "crc32_arm")) {
-		crc32_fn = crc32_arm;
-	} else if (!strcmp(type, "crc32_arm_long")) {
-		crc32_fn = crc32_arm_long;
+
+	if (!strcmp(type, "all")) return crc_sweep(len, runs);
+	if (!strcmp(type, "crc32_copy")) return crc_copy_bench(32, nbuf, len, verbose);
+	if (!strcmp(type, "crc64_copy")) return crc_copy_bench(64, nbuf, len, verbose);
+#if HAVE_CLMUL_BATCH
+	if (!strcmp(type, "crc32_clmul_batch"))
+		return crc_batch_bench(32, plo, phi, nbuf, len, verbose);
+	if (!strcmp(type, "crc64_clmul_batch"))
+		return crc_batch_bench(64, plo, phi, nbuf, len, verbose);
+	if (!strcmp(type, "crc32_iov")) return crc_iov_bench(32, plo, phi, nbuf, len, verbose);
+	if (!strcmp(type, "crc64_iov")) return crc_iov_bench(64, plo, phi, nbuf, len, verbose);
 #endif
-#ifdef __SSE4_2__
-	} else if (!strcmp(type, "crc32_intel")) {
-		crc32_fn = crc32_intel;
-		crc32_check_fn = crc32_check2;
-	} else if (!strcmp(type, "crc32_intel_long")) {
-		crc32_fn = crc32_intel_long;
-		crc32_check_fn = crc32_check2;
+	for (v = crc_variants; v->name; v++) {
+		size_t k = strlen(v->name);
+		if (!strncmp(type, v->name, k) && !strcmp(type + k, "_stream")) {
+			if (v->init) v->init();
+			if (v->fn64 ? (v->check64 ? v->check64 : crc64_check)(v->fn64) :
+					(v->check32 ? v->check32 : crc32_check)(v->fn32)) return 3;
+			return crc_stream_bench(v, plo, phi, nbuf, len, verbose);
+		}
+		if (!strcmp(type, v->name)) break;
+	}
+	if (!v->name) return 1;
+	if (v->init) v->init();
+	crc32_fn = v->fn32; crc64_fn = v->fn64;
+	if (v->check32) crc32_check_fn = v->check32;
+	if (v->check64) crc64_check_fn = v->check64;
+#ifdef WITH_DISPATCH
+	if (crc32_fn == crc32) type = crc32_kernel(nbuf);
+	if (crc64_fn == crc64) type = crc64_kernel(nbuf);
 #endif
 
-	} else return 1;
-
 #ifdef PERF_CPU
 	{
 		cpu_set_t set;
@@ -465,46 +1570,186 @@ int main(int argc, char **argv) {
 	}
 #endif
 
+#if WITH_MMAP
+	/* so that cycles/byte is per byte of the file */
+	if (f && crc_file_size(f) >= 0) len = crc_file_size(f);
+	/* falls back to reading, e.g. for stdin */
+	if (f && map_flags >= 0) {
+		IO_START
+		map = crc_map_file(f, map_flags, &nmap);
+		IO_STOP
+		if (map) io_name = "mmap";
+	}
+#endif
+#if WITH_THREADS
+	if (f && !map && depth) {
+		if (crc_reader_open(&reader, fileno(f), nbuf, depth, read_flags)) {
+			printf("!!! can't start the reader\n");
+			return 2;
+		}
+		rd = &reader;
+		io_name = "read wait";
+		/* O_DIRECT rounds it up */
+		nbuf = reader.chunk;
+	}
+#endif
+
 	TIMER_INIT
 
+	if (combine_check()) return 3;
+#if WITH_THREADS
+	rpoly = crc_variant_rpoly(v, &msb);
+#endif
+
+	/* a file is read once, only a mapping can be passed over again */
+	if (warmup < 0) warmup = runs > 1;
+	if (f && !map && runs + warmup > 1) {
+		printf("!!! -r and -W need generated data or -m\n");
+		return 1;
+	}
+	len0 = len; nmap0 = nmap;
+	samples = (double*)malloc(runs * sizeof(*samples));
+	times = (double*)malloc(runs * sizeof(*times));
+
+	arena = nbuf;
+#if WITH_BUFFER
+	if (bopt) {
+		if (!(buf = crc_buffer_alloc(&bufopt, nbuf))) return 2;
+		arena = bufopt.arena;
+	} else
+#endif
 	buf = malloc(nbuf);
-	if (!buf) return 2;
+	if (!buf || !samples || !times) return 2;
+	data = map ? map : buf;
 
-	if (!f)
+	/* the same data in every chunk of the arena */
+	if (!f) {
 		for (n = 0; n < nbuf; n++) buf[n] = n * 0x76543210u >> 24;
+		for (; n < arena; n += nbuf) memcpy(buf + n, buf, nbuf);
+	}
 
 	if (crc64_fn) {
-		uint64_t crc = 0;
-		if (crc64_check(crc64_fn)) return 3;
-		do {
-			if (f) n = fread(buf, 1, nbuf, f);
-			else len -= n = len > nbuf ? nbuf : len;
+		uint64_t crc = 0, crc1 = 0;
+		if (crc64_check_fn(crc64_fn)) return 3;
+#if WITH_THREADS
+		if (nthreads > 1 && crc_parallel_check(v, nthreads)) return 3;
+#endif
+		RUN_BEGIN do {
+			/* the whole mapping at once, then n = 0 */
+			if (map) n = nmap, nmap = 0;
+#if WITH_THREADS
+			else if (rd) {
+				IO_START
+				if (!(data = crc_reader_next(rd, &n))) n = 0;
+				IO_STOP
+			}
+#endif
+			else if (f) {
+				IO_START
+				n = fread(buf, 1, nbuf, f);
+				IO_STOP
+			} else {
+				len -= n = len > nbuf ? nbuf : len;
+				data = buf + arena_pos;
+				if ((arena_pos += nbuf) >= arena) arena_pos = 0;
+			}
 			if (!n) break;
-			TIMER_START
-			crc = crc64_fn(buf, n, crc);
-			TIMER_STOP
+			RUN_START
+#if WITH_THREADS
+			if (nthreads > 1)
+				crc = crc64_parallel_fn(crc64_fn, rpoly, msb, data, n, crc, nthreads);
+			else
+#endif
+			crc = crc64_fn(data, n, crc);
+			RUN_STOP
 		} while (n == nbuf);
-		printf("%016llx", (long long)crc);
+		RUN_END
+		snprintf(rec.crc, sizeof(rec.crc), "%016llx", (long long)crc);
 	} else {
-		uint32_t crc = 0;
+		uint32_t crc = 0, crc1 = 0;
 		if (crc32_check_fn(crc32_fn)) return 3;
-		do {
-			if (f) n = fread(buf, 1, nbuf, f);
-			else len -= n = len > nbuf ? nbuf : len;
+#if WITH_THREADS
+		if (nthreads > 1 && crc_parallel_check(v, nthreads)) return 3;
+#endif
+		RUN_BEGIN do {
+			/* the whole mapping at once, then n = 0 */
+			if (map) n = nmap, nmap = 0;
+#if WITH_THREADS
+			else if (rd) {
+				IO_START
+				if (!(data = crc_reader_next(rd, &n))) n = 0;
+				IO_STOP
+			}
+#endif
+			else if (f) {
+				IO_START
+				n = fread(buf, 1, nbuf, f);
+				IO_STOP
+			} else {
+				len -= n = len > nbuf ? nbuf : len;
+				data = buf + arena_pos;
+				if ((arena_pos += nbuf) >= arena) arena_pos = 0;
+			}
 			if (!n) break;
-			TIMER_START
-			crc = crc32_fn(buf, n, crc);
-			TIMER_STOP
+			RUN_START
+#if WITH_THREADS
+			if (nthreads > 1)
+				crc = crc32_parallel_fn(crc32_fn, (uint32_t)rpoly, msb, data, n, crc, nthreads);
+			else
+#endif
+			crc = crc32_fn(data, n, crc);
+			RUN_STOP
 		} while (n == nbuf);
-		printf("%08x", crc);
+		RUN_END
+		snprintf(rec.crc, sizeof(rec.crc), "%08x", crc);
 	}
 
-	if (verbose > 0) {
-		TIMER_PRINT
+	if (crc_format != CRC_FMT_TEXT) {
+		crc_stats_t st, tt;
+		crc_stats_calc(&st, samples, runs);
+		crc_stats_calc(&tt, times, runs);
+		rec.variant = type; rec.poly = crc_variant_poly(v);
+		rec.unit = WITH_CYCLES ? "cycles" : "ns";
+		/* the requested offset, as in the sweep: none, the start of buf */
+		rec.len = bytes; rec.align = 0; rec.runs = runs;
+		rec.ms = tt.median; rec.cpb = st.median;
+		rec.cpb_min = st.min; rec.cpb_p90 = st.p90;
+		rec.stddev = 100 * st.stddev / st.mean;
+		rec.insn = TIMER_INSNS;
+		rec.ghz = WITH_CYCLES && ns_all ? (double)stamps / ns_all : 0;
+		rec.gbps = tt.median ? bytes / tt.median * 1e-6 : 0;
+		crc_report_header();
+		crc_report(&rec);
+	} else {
+		printf("%s", rec.crc);
+		if (verbose > 0) {
+			TIMER_PRINT
+			if (ns) printf(", %.2f GB/s", (double)bytes / ns);
+			if (f) printf(", %s: %.3fms", io_name, io_ms);
+		}
+		printf("\n");
+		if (verbose > 0 && runs > 1) {
+			crc_stats_t st;
+			crc_stats_calc(&st, samples, runs);
+			crc_stats_print(&st, WITH_CYCLES ? "cycles/byte" : "ns/byte");
+		}
 	}
-	printf("\n");
+	free(samples); free(times);
 
+#if WITH_MMAP
+	if (map) crc_unmap_file(map, len);
+#endif
+#if WITH_THREADS
+	if (rd) {
+		if (rd->err) printf("!!! read error %i\n", rd->err);
+		crc_reader_close(rd);
+	}
+#endif
 	if (f && f != stdin) fclose(f);
+#if WITH_BUFFER
+	if (bopt) crc_buffer_free(&bufopt, buf);
+	else
+#endif
 	free(buf);
 }
 
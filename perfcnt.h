@@ -1,4 +1,6 @@
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
@@ -6,12 +8,39 @@
 
 #include <linux/perf_event.h>
 
+/*
+ * Extra events, a comma-separated list from -e:
+ * l1d, llc, branch, dtlb (misses per byte), topdown (x86 with the
+ * slots event, % of slots), freq (APERF/MPERF from the msr PMU).
+ * The ones the CPU or kernel doesn't have are dropped with a note.
+ */
+#define PERF_EXTRA_MAX 8
+#define PERF_TOPDOWN 4 // retiring, bad speculation, frontend, backend
+
 struct perf_counters {
 	uint64_t n;          // number of fields below
 	uint64_t cycles, insns, nsec;
+	uint64_t extra[PERF_EXTRA_MAX];
+	uint64_t slots, topdown[PERF_TOPDOWN];
+	uint64_t aperf, mperf;
+};
+
+static const struct perf_extra {
+	const char *name; uint32_t type; uint64_t config;
+} perf_extras[] = {
+	{ "l1d", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+		PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16 },
+	{ "llc", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	{ "branch", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	{ "dtlb", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+		PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16 },
+	{ NULL, 0, 0 }
 };
 
-static int perf_fd = -1;
+static int perf_fd = -1, perf_td_fd = -1, perf_msr_fd = -1;
+static const char *perf_events = "";
+static const struct perf_extra *perf_extra_used[PERF_EXTRA_MAX];
+static int perf_nextra;
 
 static ssize_t sys_read(int fd, void *buf, size_t size) {
 	ssize_t r;
@@ -30,6 +59,66 @@ static int perf_event_open(
 	return syscall(SYS_perf_event_open, attr, pid, cpu, groupfd, flags);
 }
 
+static int perf_event_wanted(const char *name) {
+	size_t n = strlen(name);
+	const char *s = perf_events;
+	if (!strcmp(s, "all")) return 1;
+	for (; (s = strstr(s, name)); s += n)
+		if ((s == perf_events || s[-1] == ',') && (!s[n] || s[n] == ','))
+			return 1;
+	return 0;
+}
+
+/*
+ * a group of count events of one PMU, -1 if any of them fails; user only
+ * with exclude, else the msr PMU, which rejects the exclude bits
+ */
+static int perf_group_open(uint32_t type, const uint64_t *config, int count, int exclude) {
+	struct perf_event_attr evt = {
+		.size = sizeof(evt),
+		.read_format = PERF_FORMAT_GROUP,
+	};
+	int fd = -1, i;
+	evt.type = type;
+	evt.exclude_kernel = evt.exclude_hv = exclude;
+	for (i = 0; i < count; i++) {
+		int fd1;
+		evt.config = config[i];
+		if ((fd1 = perf_event_open(&evt, 0, -1, fd, 0)) < 0) {
+			if (fd >= 0) close(fd);
+			return -1;
+		}
+		if (fd < 0) fd = fd1;
+	}
+	ioctl(fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	return fd;
+}
+
+/* the topdown and APERF/MPERF groups, they can't join the cycles one */
+static void perf_init_groups(void) {
+	FILE *f;
+	if (perf_event_wanted("topdown")) {
+#ifdef __x86_64__
+		/* slots, then the retiring/bad-spec/fe-bound/be-bound metrics */
+		static const uint64_t td[] = { 0x0400, 0x8000, 0x8100, 0x8200, 0x8300 };
+		perf_td_fd = perf_group_open(PERF_TYPE_RAW, td, 5, 1);
+#endif
+		if (perf_td_fd < 0) printf("!!! topdown is not supported\n");
+	}
+	if (perf_event_wanted("freq")) {
+		/* PERF_MSR_APERF = 1, PERF_MSR_MPERF = 2 */
+		static const uint64_t msr[] = { 1, 2 };
+		unsigned type;
+		if (!access("/sys/bus/event_source/devices/msr/events/aperf", F_OK) &&
+				(f = fopen("/sys/bus/event_source/devices/msr/type", "r"))) {
+			if (fscanf(f, "%u", &type) == 1)
+				perf_msr_fd = perf_group_open(type, msr, 2, 0);
+			fclose(f);
+		}
+		if (perf_msr_fd < 0) printf("!!! aperf/mperf is not supported\n");
+	}
+}
+
 static int perf_init(void) {
 	struct perf_event_attr evt = {
 		.size = sizeof(evt),
@@ -58,8 +147,19 @@ static int perf_init(void) {
 #endif
 		if (perf_event_open(&evt, 0, -1, fd, 0) < 0) break;
 #endif
+		{
+			const struct perf_extra *e;
+			for (e = perf_extras; e->name; e++) {
+				if (!perf_event_wanted(e->name)) continue;
+				evt.type = e->type; evt.config = e->config;
+				if (perf_event_open(&evt, 0, -1, fd, 0) < 0)
+					printf("!!! %s is not supported\n", e->name);
+				else perf_extra_used[perf_nextra++] = e;
+			}
+		}
 		if (ioctl(fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP) < 0) break;
 		perf_fd = fd;
+		perf_init_groups();
 		return fd;
 	} while (0);
 	printf("!!! perf_event_open failed\n");
@@ -79,20 +179,52 @@ static int perf_init(void) {
 }
 
 static int perf_read(struct perf_counters *cnt) {
+	uint64_t v[1 + 3 + PERF_EXTRA_MAX];
+	int i, k = 3, r;
 #if !WITH_CYCLES || !defined(RDTSC_GHZ)
 #define CYCLES_READ(x)
-	return sys_read(perf_fd, cnt, sizeof(*cnt));
+	k++;
 #else
 #define PERF_TIME_DIV (double)(RDTSC_GHZ)
 #define CYCLES_READ(x) x.nsec = get_cycles();
-	return sys_read(perf_fd, cnt, sizeof(*cnt) - sizeof(cnt->nsec));
 #endif
+	/* the extra events follow cycles, insns and the time if any */
+	r = sys_read(perf_fd, v, (k + perf_nextra) * sizeof(v[0]));
+	cnt->cycles = v[1]; cnt->insns = v[2];
+	if (k > 3) cnt->nsec = v[3];
+	for (i = 0; i < perf_nextra; i++) cnt->extra[i] = v[k + i];
+	if (perf_td_fd >= 0 && sys_read(perf_td_fd, v, 6 * sizeof(v[0])) > 0) {
+		cnt->slots = v[1];
+		for (i = 0; i < PERF_TOPDOWN; i++) cnt->topdown[i] = v[2 + i];
+	}
+	if (perf_msr_fd >= 0 && sys_read(perf_msr_fd, v, 3 * sizeof(v[0])) > 0)
+		cnt->aperf = v[1], cnt->mperf = v[2];
+	return r;
+}
+
+/* the extra events over the whole run, per byte or as a fraction */
+static void perf_print(const struct perf_counters *sum, uint64_t time, size_t bytes) {
+	static const char *td_names[PERF_TOPDOWN] = { "retiring", "bad spec", "frontend", "backend" };
+	int i;
+	if (!bytes) return;
+	for (i = 0; i < perf_nextra; i++)
+		printf(", %.5f %s-miss/byte", (double)sum->extra[i] / bytes, perf_extra_used[i]->name);
+	if (perf_td_fd >= 0 && sum->slots)
+		for (i = 0; i < PERF_TOPDOWN; i++)
+			printf(", %s %.1f%%", td_names[i], 100.0 * sum->topdown[i] / sum->slots);
+	/* MPERF ticks at the TSC rate, APERF at the actual one */
+	if (perf_msr_fd >= 0 && sum->mperf && time)
+		printf(", aperf/mperf %.3f (%.3f GHz)", (double)sum->aperf / sum->mperf,
+				PERF_TIME_DIV * sum->aperf / time);
 }
 
 #define TIMER_DEF \
 	uint64_t time = 0, cycles = 0; \
 	double min_cycles = 1e9, min_insns = 1e9; \
-	struct perf_counters perf0, perf1;
+	struct perf_counters perf0 = { 0 }, perf1 = { 0 }, perf_sum = { 0 }; \
+	size_t perf_bytes = 0;
+
+#define TIMER_INSNS min_insns
 
 #define TIMER_INIT \
 	if (perf_init() < 0) return 2;
@@ -109,10 +241,19 @@ static int perf_read(struct perf_counters *cnt) {
 		min_insns = (double)(perf1.insns - perf0.insns) / n; \
 	} \
 	time += perf1.nsec - perf0.nsec; \
+	perf_bytes += n; \
+	for (int i_ = 0; i_ < PERF_EXTRA_MAX; i_++) \
+		perf_sum.extra[i_] += perf1.extra[i_] - perf0.extra[i_]; \
+	perf_sum.slots += perf1.slots - perf0.slots; \
+	for (int i_ = 0; i_ < PERF_TOPDOWN; i_++) \
+		perf_sum.topdown[i_] += perf1.topdown[i_] - perf0.topdown[i_]; \
+	perf_sum.aperf += perf1.aperf - perf0.aperf; \
+	perf_sum.mperf += perf1.mperf - perf0.mperf; \
 }
 
 #define TIMER_PRINT \
 	printf(" %s: %.3fms", type, time * (1e-6 / PERF_TIME_DIV)); \
 	printf(", %.3f cycles/byte, %.3f insn/byte (%.3f GHz)", \
-			min_cycles, min_insns, PERF_TIME_DIV * (int64_t)cycles / (int64_t)time);
+			min_cycles, min_insns, PERF_TIME_DIV * (int64_t)cycles / (int64_t)time); \
+	perf_print(&perf_sum, time, perf_bytes);
 
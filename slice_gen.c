@@ -0,0 +1,64 @@
+/*
+ * Generator of the slice-by-N lookup tables for crc_slice16.h, printed as
+ * static const arrays so they are in .rodata, with no init at run time.
+ *
+ * cc -O2 slice_gen.c -o slice_gen
+ * (./slice_gen -w 32 -p 0xedb88320 -f crc32_table16; \
+ *  ./slice_gen -w 64 -p 0xc96c5795d7870f42 -f crc64_table16 -a) > crc_slice_tables.h
+ *
+ * -a appends to the output of an earlier run: a blank line instead of
+ * the header.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char **argv) {
+	uint64_t p = 0xc96c5795d7870f42, a, t[256];
+	int bits = 64, n = 16, append = 0, i, j, k;
+	const char *name = "crc64_table16";
+
+	while (argc > 1) {
+		if (argc > 2 && !strcmp(argv[1], "-p")) {
+			p = strtoull(argv[2], NULL, 0);
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-w")) {
+			bits = atoi(argv[2]);
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-n")) {
+			n = atoi(argv[2]);
+			argc -= 2; argv += 2;
+		} else if (argc > 2 && !strcmp(argv[1], "-f")) {
+			name = argv[2];
+			argc -= 2; argv += 2;
+		} else if (!strcmp(argv[1], "-a")) {
+			append = 1;
+			argc--; argv++;
+		} else return 1;
+	}
+	if ((bits != 32 && bits != 64) || n < 1) return 1;
+
+	/* table j: a byte followed by j zero bytes */
+	for (i = 0; i < 256; i++) t[i] = i;
+	printf(append ? "\n" : "/* generated by slice_gen.c, do not edit */\n\n");
+	printf("static const uint%i_t %s[%i][256] = {\n", bits, name, n);
+	for (j = 0; j < n; j++) {
+		printf("{\n");
+		for (i = 0; i < 256; i++) {
+			for (a = t[i], k = 0; k < 8; k++)
+				a = (a >> 1) ^ (a & 1 ? p : 0);
+			t[i] = a;
+			if (bits == 32)
+				printf("%s0x%08x,%s", i & 7 ? " " : "\t",
+						(unsigned)a, (i & 7) == 7 ? "\n" : "");
+			else
+				printf("%s0x%016llx,%s", i & 3 ? " " : "\t",
+						(unsigned long long)a, (i & 3) == 3 ? "\n" : "");
+		}
+		printf("}%s\n", j < n - 1 ? "," : "");
+	}
+	printf("};\n");
+	return 0;
+}